@@ -0,0 +1,227 @@
+#ifndef _ASYNC_PR_QUEUE_H
+#define _ASYNC_PR_QUEUE_H
+
+/*
+ * A PriorityQueue for C++20 coroutines. Instead of polling empty(), a
+ * consumer writes
+ *
+ *   DetachedTask worker(AsyncPriorityQueue<Job> & q) {
+ *     for(;;) { Job job = co_await q.pop(); handle(job); }
+ *   }
+ *
+ * and is suspended until an element is available. Each insert wakes at most
+ * one waiting consumer (first come, first served) by posting it to an
+ * Executor; when it runs it takes the lowest priority value element in the
+ * queue at that moment, so consumers always see elements in priority order.
+ * No threads are involved: everything runs on whichever thread drives the
+ * executor.
+ *
+ * RunQueueExecutor is a minimal single-threaded executor. To drive it from
+ * an epoll loop, register event_fd() for EPOLLIN and call run() whenever it
+ * becomes readable.
+ *
+ * Requires C++20.
+ */
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "12750826PriorityQueue.h"
+
+/*
+ * @desc Something that can resume coroutines later, e.g. an event loop.
+ */
+class Executor {
+
+public:
+
+  virtual ~Executor() {}
+
+  /* Schedules "handle" to be resumed by the executor (never inline). */
+  virtual void post(std::coroutine_handle<> handle) = 0;
+};
+
+/*
+ * @desc Single-threaded FIFO run queue of coroutines.
+ */
+class RunQueueExecutor : public Executor {
+
+private:
+
+  std::deque<std::coroutine_handle<> > ready;
+  int wakeFd;
+
+public:
+
+  RunQueueExecutor() : wakeFd(-1) {}
+
+  ~RunQueueExecutor()
+  {
+    if(wakeFd >= 0) { close(wakeFd); }
+  }
+
+  RunQueueExecutor(const RunQueueExecutor &) = delete;
+  RunQueueExecutor & operator=(const RunQueueExecutor &) = delete;
+
+  void post(std::coroutine_handle<> handle)
+  {
+    uint64_t one = 1;
+
+    ready.push_back(handle);
+    if(wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) != sizeof(one)) { /* Counter is saturated; already readable. */ }
+  }
+
+  /*
+   * @desc   Resumes the oldest ready coroutine.
+   * @return False if there was nothing to run.
+   */
+  bool run_once()
+  {
+    if(ready.empty()) { return false; }
+
+    std::coroutine_handle<> handle = ready.front();
+    ready.pop_front();
+    handle.resume();
+    return true;
+  }
+
+  /*
+   * @desc Resumes coroutines until none are ready.
+   */
+  void run()
+  {
+    uint64_t count;
+
+    if(wakeFd >= 0 && read(wakeFd, &count, sizeof(count)) != sizeof(count)) { /* Nothing was pending. */ }
+    while(run_once()) {}
+  }
+
+  /*
+   * @desc  Non-blocking eventfd that is readable while coroutines are
+   *        ready; created on first use.
+   */
+  int event_fd()
+  {
+    if(wakeFd < 0)
+    {
+      wakeFd = eventfd(ready.size(), EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    return wakeFd;
+  }
+
+  bool empty() const { return ready.empty(); }
+};
+
+/*
+ * @desc  Return type for fire-and-forget coroutines such as queue consumers.
+ *        The coroutine starts immediately and frees itself when it finishes.
+ */
+struct DetachedTask {
+
+  struct promise_type {
+    DetachedTask get_return_object() { return DetachedTask(); }
+    std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+    std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+template <typename E, typename Layout = BinaryHeapLayout>
+class AsyncPriorityQueue {
+
+private:
+
+  /*
+   * @desc Awaitable returned by pop().
+   */
+  struct PopAwaiter {
+
+    AsyncPriorityQueue * queue;
+    std::coroutine_handle<> handle;
+    bool woken;
+
+    bool await_ready() const { return queue->available() > 0; }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      handle = h;
+      queue->waiters.push_back(this);
+    }
+
+    E await_resume()
+    {
+      // A woken consumer had an element reserved for it by insert().
+      if(woken) { queue->reserved--; }
+      return queue->queue.remove_front();
+    }
+  };
+
+  PriorityQueue<E, Layout> queue;
+  std::deque<PopAwaiter *> waiters;
+  Executor & executor;
+  int reserved; // Elements promised to woken consumers that have not run yet.
+
+  int available() { return queue.size() - reserved; }
+
+public:
+
+  explicit AsyncPriorityQueue(Executor & e) : executor(e), reserved(0) {}
+
+  AsyncPriorityQueue(const AsyncPriorityQueue &) = delete;
+  AsyncPriorityQueue & operator=(const AsyncPriorityQueue &) = delete;
+
+  /*
+   * @desc This function adds a new element "element" to the queue
+   *       with priority "priority", and wakes the oldest waiting consumer.
+   */
+  void insert(int priority, E element)
+  {
+    if(priority < 0) { return; } // Same rule as PriorityQueue::insert.
+
+    queue.insert(priority, element);
+    if(!waiters.empty())
+    {
+      PopAwaiter * waiter = waiters.front();
+      waiters.pop_front();
+      waiter->woken = true;
+      reserved++;
+      executor.post(waiter->handle);
+    }
+  }
+
+  /*
+   * @desc  co_await pop() yields the lowest priority value element, suspending
+   *        the caller until one is available. A suspended caller must not be
+   *        destroyed before it is resumed.
+   */
+  PopAwaiter pop() { return PopAwaiter{this, std::coroutine_handle<>(), false}; }
+
+  /*
+   * @desc Takes the lowest priority value element without waiting.
+   * @return False if no element is available to this caller.
+   */
+  bool try_pop(E & element)
+  {
+    if(available() <= 0) { return false; }
+    element = queue.remove_front();
+    return true;
+  }
+
+  /*
+   * @desc Number of elements in the queue, including any already promised
+   *       to woken consumers.
+   */
+  int size() { return queue.size(); }
+
+  bool empty() { return queue.empty(); }
+
+  /*
+   * @desc Number of consumers suspended in pop().
+   */
+  int waiting() const { return waiters.size(); }
+};
+
+#endif
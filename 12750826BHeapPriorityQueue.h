@@ -0,0 +1,136 @@
+#ifndef _BHEAP_PR_QUEUE_H
+#define _BHEAP_PR_QUEUE_H
+
+/*
+ * A page-aware memory layout for PriorityQueue (a "B-heap").
+ *
+ * In the binary layout every level of heapifyDown lands on a different
+ * page once the queue is larger than a few thousand nodes, so a pop on a
+ * queue of 100M entries touches ~27 pages. Here the heap is cut into
+ * subtrees that each fill exactly one page, so a root-to-leaf walk only
+ * changes page once every log2(nodes per page) levels.
+ *
+ * Usage is the same as PriorityQueue:
+ *
+ *   BHeapPriorityQueue<Job> q;                    // 4 KiB pages
+ *   BHeapPriorityQueue<Job, 2 * 1024 * 1024> big; // 2 MiB huge pages
+ *
+ * Requires C++11.
+ */
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+#include "12750826PriorityQueue.h"
+
+/*
+ * @desc  Allocator that hands out memory aligned to a page boundary, so
+ *        every page of the layout below maps onto exactly one OS page.
+ *        Allocations of 2 MiB or more are also advised to use huge pages.
+ */
+template <typename T, std::size_t Alignment>
+class PageAlignedAllocator {
+
+public:
+
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind { typedef PageAlignedAllocator<U, Alignment> other; };
+
+  PageAlignedAllocator() {}
+
+  template <typename U>
+  PageAlignedAllocator(const PageAlignedAllocator<U, Alignment> &) {}
+
+  T * allocate(std::size_t n)
+  {
+    void * memory = 0;
+    std::size_t bytes = n * sizeof(T);
+
+    if(posix_memalign(&memory, Alignment, bytes) != 0) { throw std::bad_alloc(); }
+#ifdef MADV_HUGEPAGE
+    if(Alignment >= 2 * 1024 * 1024) { madvise(memory, bytes, MADV_HUGEPAGE); }
+#endif
+    return static_cast<T *>(memory);
+  }
+
+  void deallocate(T * p, std::size_t) { free(p); }
+
+  template <typename U>
+  bool operator==(const PageAlignedAllocator<U, Alignment> &) const { return true; }
+
+  template <typename U>
+  bool operator!=(const PageAlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+/*
+ * @desc  Layout policy for PriorityQueue that packs subtrees into pages of
+ *        NodesPerPage nodes (must be a power of two).
+ *
+ *        Inside a page the nodes form a small binary heap (local children
+ *        of j at 2j + 1 and 2j + 2). The nodes on the bottom edge of a page
+ *        have their children at the root of another page, so the pages
+ *        themselves form a tree with NodesPerPage + 1 children per page,
+ *        numbered breadth first. Every node's parent lives at a lower index,
+ *        so the queue still fills 'nodes' densely from the front and
+ *        insert/remove_front only ever touch the last slot.
+ */
+template <std::size_t NodesPerPage, std::size_t PageBytes>
+struct BHeapLayout {
+
+  template <typename Node>
+  struct storage { typedef std::vector<Node, PageAlignedAllocator<Node, PageBytes> > type; };
+
+  static std::size_t parent(std::size_t index)
+  {
+    const std::size_t P = NodesPerPage;
+    std::size_t page = index / P;
+    std::size_t local = index % P;
+    std::size_t parentPage, edge;
+
+    if(local > 0) { return page * P + (local - 1) / 2; } // Parent is in the same page.
+
+    // Page root: find which bottom edge slot of the parent page points here.
+    parentPage = (page - 1) / (P + 1);
+    edge = (page - 1) % (P + 1);
+
+    if(edge == P) { return parentPage * P + P / 2 - 1; } // Second child of node P/2 - 1.
+    return parentPage * P + P / 2 + edge / 2;
+  }
+
+  /* @param k 0 for the left child, 1 for the right child. */
+  static std::size_t child(std::size_t index, int k)
+  {
+    const std::size_t P = NodesPerPage;
+    std::size_t page = index / P;
+    std::size_t local = index % P;
+    std::size_t localChild = 2 * local + 1 + k;
+    std::size_t edge;
+
+    if(localChild < P) { return page * P + localChild; } // Child is in the same page.
+
+    // Leaves of the page hand out two edges each; node P/2 - 1 hands out its right child as the last edge.
+    edge = (local >= P / 2) ? (local - P / 2) * 2 + k : P;
+    return (page * (P + 1) + 1 + edge) * P;
+  }
+};
+
+/*
+ * @desc  Largest power of two number of Node that fits in PageBytes
+ *        (at least 4, so a page always holds a root with two children).
+ */
+constexpr std::size_t bheapNodesPerPage(std::size_t pageBytes, std::size_t nodeBytes, std::size_t n = 4)
+{
+  return (n * 2 * nodeBytes <= pageBytes) ? bheapNodesPerPage(pageBytes, nodeBytes, n * 2) : n;
+}
+
+/*
+ * @desc  PriorityQueue<E> laid out as a B-heap over pages of PageBytes.
+ */
+template <typename E, std::size_t PageBytes = 4096>
+using BHeapPriorityQueue =
+  PriorityQueue<E, BHeapLayout<bheapNodesPerPage(PageBytes, sizeof(std::pair<int,E>)), PageBytes> >;
+
+#endif
@@ -0,0 +1,292 @@
+#ifndef _BITMAP_PR_QUEUE_H
+#define _BITMAP_PR_QUEUE_H
+
+/*
+ * A priority queue for priorities from a bounded universe
+ * 0 <= priority < 2^UniverseBits (2^24 by default), with the same interface
+ * as PriorityQueue.
+ *
+ * Occupied priorities are tracked in a hierarchical bitmap of 64-bit words
+ * (a 64-way van Emde Boas style tree): bit b of word w on level l + 1 is set
+ * when word 64w + b on level l is non-zero. Finding the minimum or the
+ * successor of a priority is one count-trailing-zeros (tzcnt) per level,
+ * i.e. ceil(UniverseBits / 6) steps (4 for 2^24), whatever the number of
+ * elements, and unlike a radix heap the priorities do not need to be
+ * monotone. Elements with the same priority come out in insertion order.
+ *
+ * Memory is 2^UniverseBits / 8 bytes of bitmap (2 MiB for 2^24) plus the
+ * elements themselves. Build with -mbmi (or -march=native) to get tzcnt.
+ */
+#include <vector>
+#include <deque>
+#include <utility>
+#include <unordered_map>
+#include <cstdint>
+
+template <typename E, int UniverseBits = 24>
+class BitmapPriorityQueue {
+
+private:
+
+  static const int Levels = (UniverseBits + 5) / 6;
+
+  /*
+   * @desc levels[0] has one bit per priority, levels[Levels - 1] is a single word.
+   */
+  std::vector<uint64_t> levels[Levels];
+  std::unordered_map<int, std::deque<E> > buckets;
+  int count;
+
+  static int lowestBit(uint64_t word) { return __builtin_ctzll(word); }
+
+  /*
+   * @desc  Smallest occupied priority in the subtree of word "index" on
+   *        level "level"; the word must be non-zero.
+   */
+  int descend(int level, uint64_t index) const
+  {
+    while(level >= 0)
+    {
+      index = index * 64 + lowestBit(levels[level][index]);
+      level--;
+    }
+    return (int)index;
+  }
+
+  void mark(int priority)
+  {
+    uint64_t key = priority;
+    int l;
+
+    for(l = 0; l < Levels; l++)
+    {
+      uint64_t & word = levels[l][key >> 6];
+      bool wasEmpty = (word == 0);
+
+      word |= (uint64_t)1 << (key & 63);
+      if(!wasEmpty) { break; } // The levels above already know this word is occupied.
+      key >>= 6;
+    }
+  }
+
+  void unmark(int priority)
+  {
+    uint64_t key = priority;
+    int l;
+
+    for(l = 0; l < Levels; l++)
+    {
+      uint64_t & word = levels[l][key >> 6];
+
+      word &= ~((uint64_t)1 << (key & 63));
+      if(word != 0) { break; } // Still occupied, so the levels above stay set.
+      key >>= 6;
+    }
+  }
+
+public:
+
+  BitmapPriorityQueue() : count(0)
+  {
+    uint64_t words = ((uint64_t)1 << UniverseBits) / 64;
+    int l;
+
+    for(l = 0; l < Levels; l++)
+    {
+      levels[l].assign(words > 0 ? words : 1, 0);
+      words /= 64;
+    }
+  }
+
+  /*
+   * @desc  Returns the smallest occupied priority that is >= "priority",
+   *        or -1 if there is none.
+   */
+  int successor(int priority) const
+  {
+    uint64_t key = priority < 0 ? 0 : priority;
+    int l;
+
+    if(key >> UniverseBits) { return -1; }
+
+    // Climb until a word has an occupied slot at or after our position,
+    // moving on to the next word (one position up a level) each time.
+    for(l = 0; l < Levels; l++)
+    {
+      uint64_t index = key >> 6;
+      uint64_t word;
+
+      if(index >= levels[l].size()) { return -1; }
+      word = levels[l][index] & (~(uint64_t)0 << (key & 63));
+      if(word != 0) { return descend(l - 1, index * 64 + lowestBit(word)); }
+      key = index + 1;
+    }
+    return -1;
+  }
+
+  /*
+   * @desc  Returns the lowest occupied priority, or -1 if the queue is empty.
+   */
+  int front_priority() const
+  {
+    if(count == 0) { return -1; }
+    return descend(Levels - 1, 0);
+  }
+
+  /*
+   * @desc This function adds a new element "element" to the queue
+   *       with priority "priority". Priorities outside the universe are ignored.
+   */
+  void insert(int priority, E element)
+  {
+    if(priority < 0 || ((uint64_t)priority >> UniverseBits)) { return; }
+
+    std::deque<E> & bucket = buckets[priority];
+    if(bucket.empty()) { mark(priority); }
+    bucket.push_back(element);
+    count++;
+  }
+
+  /*
+   * @desc Similar to insert, but takes a whole vector of new things to add.
+   */
+  void insert_all(std::vector<std::pair<int,E> > new_elements)
+  {
+    typename std::vector<std::pair<int,E> >::iterator it;
+
+    for(it = new_elements.begin(); it != new_elements.end(); it++)
+    {
+      insert(it->first, it->second);
+    }
+  }
+
+  /*
+   * @desc Takes the lowest priority value element off the queue, and returns it.
+   */
+  E remove_front()
+  {
+    if(count == 0) { return E(); }
+
+    int priority = front_priority();
+    typename std::unordered_map<int, std::deque<E> >::iterator it = buckets.find(priority);
+    E rootElement = it->second.front();
+
+    it->second.pop_front();
+    if(it->second.empty())
+    {
+      buckets.erase(it);
+      unmark(priority);
+    }
+    count--;
+    return rootElement;
+  }
+
+  /*
+   * @desc Returns the lowest priority value element in the queue, but leaves
+   *       it in the queue.
+   */
+  E peek()
+  {
+    if(count == 0) { return E(); }
+    return buckets[front_priority()].front();
+  }
+
+  /*
+   * @return Elements - containing all the elements in the queue, in priority order.
+   */
+  std::vector<E> get_all_elements()
+  {
+    std::vector<E> elements;
+    int p;
+
+    for(p = successor(0); p >= 0; p = successor(p + 1))
+    {
+      std::deque<E> & bucket = buckets[p];
+      elements.insert(elements.end(), bucket.begin(), bucket.end());
+    }
+    return elements;
+  }
+
+  /*
+   * @desc Returns true if the queue contains element "element", false otherwise.
+   */
+  bool contains(E element) { return get_priority(element) != -1; }
+
+  /*
+   * @desc  Returns the lowest priority of an element that matches "element", or -1.
+   */
+  int get_priority(E element)
+  {
+    typename std::deque<E>::iterator it;
+    int p;
+
+    for(p = successor(0); p >= 0; p = successor(p + 1))
+    {
+      std::deque<E> & bucket = buckets[p];
+      for(it = bucket.begin(); it != bucket.end(); it++)
+      {
+        if(element == *it) { return p; }
+      }
+    }
+    return -1;
+  }
+
+  /*
+   * @return Priorities - containing the priority of every element, in order.
+   */
+  std::vector<int> get_all_priorities()
+  {
+    std::vector<int> priorities;
+    int p;
+
+    for(p = successor(0); p >= 0; p = successor(p + 1))
+    {
+      priorities.insert(priorities.end(), buckets[p].size(), p);
+    }
+    return priorities;
+  }
+
+  /*
+   * @desc  Finds the first element (in priority order) that matches
+   *        "element", and changes its priority to "new_priority".
+   */
+  void change_priority(E element, int new_priority)
+  {
+    typename std::deque<E>::iterator it;
+    int p;
+
+    if(new_priority < 0 || ((uint64_t)new_priority >> UniverseBits)) { return; }
+
+    for(p = successor(0); p >= 0; p = successor(p + 1))
+    {
+      std::deque<E> & bucket = buckets[p];
+      for(it = bucket.begin(); it != bucket.end(); it++)
+      {
+        if(element == *it)
+        {
+          bucket.erase(it);
+          if(bucket.empty())
+          {
+            buckets.erase(p);
+            unmark(p);
+          }
+          count--;
+          insert(new_priority, element);
+          return;
+        }
+      }
+    }
+  }
+
+  /*
+   * @desc Return the size of elements in queue.
+   */
+  int size() { return count; }
+
+  /*
+   * @desc Returns true if the queue has no elements, false otherwise.
+   */
+  bool empty() { return count == 0; }
+};
+
+#endif
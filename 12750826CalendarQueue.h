@@ -0,0 +1,318 @@
+#ifndef _CALENDAR_QUEUE_H
+#define _CALENDAR_QUEUE_H
+
+/*
+ * A calendar queue (R. Brown, "Calendar Queues", CACM 1988) with the same
+ * interface as PriorityQueue.
+ *
+ * Priorities are hashed into a ring of buckets ("days") of a fixed width,
+ * each kept as a sorted list. remove_front scans forward from the day of
+ * the last removed element, so when most inserts land a little after the
+ * current time (discrete-event simulation timestamps) both insert and
+ * remove_front are amortised O(1) instead of O(log n). The number of days
+ * doubles or halves as the queue grows or shrinks, and the day width is
+ * re-estimated from the gaps between the earliest elements each time.
+ *
+ * Priorities earlier than the last removed one are still accepted; they
+ * just move the scan position back.
+ */
+#include <vector>
+#include <list>
+#include <utility>
+#include <algorithm>
+#include <climits>
+
+template <typename E>
+class CalendarQueue {
+
+private:
+
+  typedef std::list<std::pair<int,E> > Bucket;
+
+  /*
+   * @desc Ring of days; each list is sorted by priority.
+   */
+  std::vector<Bucket> buckets;
+  int width;           // Range of priorities covered by one day.
+  int count;
+  int lastBucket;      // Day the next scan starts from.
+  long long bucketTop; // Priorities below this belong to this year's lastBucket.
+
+  int bucketOf(int priority) const { return (priority / width) % (int)buckets.size(); }
+
+  /*
+   * @desc  Moves the scan position to the day holding "priority".
+   */
+  void seek(int priority)
+  {
+    lastBucket = bucketOf(priority);
+    bucketTop = ((long long)priority / width + 1) * width;
+  }
+
+  /*
+   * @desc  Inserts into the sorted list of its day, without resizing.
+   */
+  void enqueue(const std::pair<int,E> & node)
+  {
+    Bucket & bucket = buckets[bucketOf(node.first)];
+    typename Bucket::iterator it = bucket.end();
+
+    // Search from the back: new events usually come after the ones already
+    // in their day. Equal priorities keep insertion order.
+    while(it != bucket.begin())
+    {
+      it--;
+      if(it->first <= node.first)
+      {
+        it++;
+        break;
+      }
+    }
+    bucket.insert(it, node);
+    count++;
+  }
+
+  /*
+   * @desc   Finds the day holding the lowest priority value and leaves the
+   *         scan position there. The queue must not be empty.
+   * @return Index of that day.
+   */
+  int locateFront()
+  {
+    int i = lastBucket;
+    long long top = bucketTop;
+    int day, best = -1;
+
+    // Walk one year of days from the current one.
+    for(day = 0; day < (int)buckets.size(); day++)
+    {
+      if(!buckets[i].empty() && buckets[i].front().first < top)
+      {
+        lastBucket = i;
+        bucketTop = top;
+        return i;
+      }
+      i = (i + 1) % buckets.size();
+      top += width;
+    }
+
+    // Nothing due within a year: fall back to a direct search of every day.
+    for(i = 0; i < (int)buckets.size(); i++)
+    {
+      if(!buckets[i].empty() && (best < 0 || buckets[i].front().first < buckets[best].front().first))
+      {
+        best = i;
+      }
+    }
+    seek(buckets[best].front().first);
+    return best;
+  }
+
+  /*
+   * @desc  Estimates a day width from the average gap between (up to) the 25
+   *        earliest priorities, ignoring gaps more than twice the average.
+   *        The width is at most INT_MAX / 2, so it fits in an int, and
+   *        bucketTop plus a year of days fits in a long long.
+   */
+  int estimateWidth(std::vector<int> & priorities) const
+  {
+    int samples = std::min<int>(priorities.size(), 25);
+    long long total = 0, kept = 0;
+    int i, n = 0;
+
+    if(samples < 2) { return width; }
+
+    std::partial_sort(priorities.begin(), priorities.begin() + samples, priorities.end());
+    total = priorities[samples - 1] - priorities[0];
+    for(i = 1; i < samples; i++)
+    {
+      long long gap = priorities[i] - priorities[i - 1];
+      if(gap * (samples - 1) <= 2 * total)
+      {
+        kept += gap;
+        n++;
+      }
+    }
+    if(n == 0 || kept == 0) { return 1; }
+    return (int)std::min<long long>(INT_MAX / 2, std::max<long long>(1, 3 * kept / n));
+  }
+
+  /*
+   * @desc  Rebuilds the calendar with "days" days and a fresh day width.
+   */
+  void resize(int days)
+  {
+    std::vector<Bucket> old;
+    std::vector<int> priorities;
+    typename std::vector<Bucket>::iterator b;
+    typename Bucket::iterator it;
+    int lowest = 0;
+
+    old.swap(buckets);
+    for(b = old.begin(); b != old.end(); b++)
+    {
+      for(it = b->begin(); it != b->end(); it++) { priorities.push_back(it->first); }
+    }
+    if(!priorities.empty()) { lowest = *std::min_element(priorities.begin(), priorities.end()); }
+
+    width = estimateWidth(priorities);
+    buckets.assign(days, Bucket());
+    count = 0;
+    for(b = old.begin(); b != old.end(); b++)
+    {
+      for(it = b->begin(); it != b->end(); it++) { enqueue(*it); }
+    }
+    seek(lowest);
+  }
+
+public:
+
+  CalendarQueue() : buckets(2), width(1), count(0), lastBucket(0), bucketTop(1) {}
+
+  /*
+   * @desc This function adds a new element "element" to the queue
+   *       with priority "priority".
+   */
+  void insert(int priority, E element)
+  {
+    if(priority < 0) { return; } // Base case to ensure we don't accept when it's less than 0.
+
+    if(count == 0 || priority < bucketTop - width) { seek(priority); } // Earlier than the scan position.
+    enqueue(std::pair<int,E>(priority, element));
+    if(count > 2 * (int)buckets.size()) { resize(2 * buckets.size()); }
+  }
+
+  /*
+   * @desc Similar to insert, but takes a whole vector of new things to add.
+   */
+  void insert_all(std::vector<std::pair<int,E> > new_elements)
+  {
+    typename std::vector<std::pair<int,E> >::iterator it;
+
+    for(it = new_elements.begin(); it != new_elements.end(); it++)
+    {
+      insert(it->first, it->second);
+    }
+  }
+
+  /*
+   * @desc Takes the lowest priority value element off the queue, and returns it.
+   */
+  E remove_front()
+  {
+    if(count == 0) { return E(); } // Returns back to the constructor if queue is empty.
+
+    Bucket & bucket = buckets[locateFront()];
+    E rootElement = bucket.front().second;
+
+    bucket.pop_front();
+    count--;
+    if(count < (int)buckets.size() / 2 && buckets.size() > 2) { resize(buckets.size() / 2); }
+    return rootElement;
+  }
+
+  /*
+   * @desc Returns the lowest priority value element in the queue, but leaves
+   *       it in the queue.
+   */
+  E peek()
+  {
+    if(count == 0) { return E(); }
+    return buckets[locateFront()].front().second;
+  }
+
+  /*
+   * @return Elements - containing all the elements in the queue (no particular order).
+   */
+  std::vector<E> get_all_elements()
+  {
+    std::vector<E> elements;
+    typename std::vector<Bucket>::iterator b;
+    typename Bucket::iterator it;
+
+    for(b = buckets.begin(); b != buckets.end(); b++)
+    {
+      for(it = b->begin(); it != b->end(); it++) { elements.push_back(it->second); }
+    }
+    return elements;
+  }
+
+  /*
+   * @desc Returns true if the queue contains element "element", false otherwise.
+   */
+  bool contains(E element) { return get_priority(element) != -1; }
+
+  /*
+   * @desc  Returns the priority of the element that matches "element", or -1.
+   */
+  int get_priority(E element)
+  {
+    typename std::vector<Bucket>::iterator b;
+    typename Bucket::iterator it;
+
+    for(b = buckets.begin(); b != buckets.end(); b++)
+    {
+      for(it = b->begin(); it != b->end(); it++)
+      {
+        if(element == it->second) { return it->first; }
+      }
+    }
+    return -1;
+  }
+
+  /*
+   * @return Priorities - containing all the priorities (no particular order).
+   */
+  std::vector<int> get_all_priorities()
+  {
+    std::vector<int> priorities;
+    typename std::vector<Bucket>::iterator b;
+    typename Bucket::iterator it;
+
+    for(b = buckets.begin(); b != buckets.end(); b++)
+    {
+      for(it = b->begin(); it != b->end(); it++) { priorities.push_back(it->first); }
+    }
+    return priorities;
+  }
+
+  /*
+   * @desc  Finds the first element that matches "element", and moves it
+   *        to the day for "new_priority". A negative priority is
+   *        rejected, as in insert, and the element stays where it is.
+   */
+  void change_priority(E element, int new_priority)
+  {
+    typename std::vector<Bucket>::iterator b;
+    typename Bucket::iterator it;
+
+    if(new_priority < 0) { return; }
+
+    for(b = buckets.begin(); b != buckets.end(); b++)
+    {
+      for(it = b->begin(); it != b->end(); it++)
+      {
+        if(element == it->second)
+        {
+          b->erase(it);
+          count--;
+          if(count == 0 || new_priority < bucketTop - width) { seek(new_priority); }
+          enqueue(std::pair<int,E>(new_priority, element));
+          return;
+        }
+      }
+    }
+  }
+
+  /*
+   * @desc Return the size of elements in queue.
+   */
+  int size() { return count; }
+
+  /*
+   * @desc Returns true if the queue has no elements, false otherwise.
+   */
+  bool empty() { return count == 0; }
+};
+
+#endif
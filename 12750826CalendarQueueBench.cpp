@@ -0,0 +1,103 @@
+/***********************
+ * Discrete-event simulation benchmark (the classic "hold model")
+ * 1. Fills the queue with N events at random times
+ * 2. Repeats the hold operation: remove the earliest event at time t and
+ *    schedule a new one at t + increment, so the queue size stays at N
+ * 3. Reports ns per hold for PriorityQueue and CalendarQueue for several
+ *    increment distributions
+ *
+ * Build: g++ -O2 -std=c++11 12750826CalendarQueueBench.cpp -o desbench
+ * Run:   ./desbench [holds]     (default: 5000000)
+ * *********************
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include "12750826PriorityQueue.h"
+#include "12750826CalendarQueue.h"
+
+/*
+ * Increment distributions from the hold model literature, all with mean ~1000.
+ */
+enum Distribution { Exponential, Uniform, Bimodal, Triangular };
+
+std::string distributionName(Distribution d)
+{
+  switch(d)
+  {
+    case Exponential : return "exponential";
+    case Uniform     : return "uniform";
+    case Bimodal     : return "bimodal";
+    case Triangular  : return "triangular";
+  }
+  return "";
+}
+
+int increment(Distribution d, std::mt19937 & rng)
+{
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  switch(d)
+  {
+    case Exponential : return (int)std::exponential_distribution<double>(1.0 / 1000)(rng);
+    case Uniform     : return (int)(unit(rng) * 2000);
+    case Bimodal     : return (int)(unit(rng) < 0.9 ? unit(rng) * 200 : 9100 + unit(rng) * 200);
+    case Triangular  : return (int)(std::max(unit(rng), unit(rng)) * 1500);
+  }
+  return 0;
+}
+
+/*
+ * Events carry their own timestamp so remove_front tells us the current time.
+ */
+template <typename Queue>
+double hold(Distribution d, int n, long holds)
+{
+  Queue q;
+  std::mt19937 rng(12750826);
+  int now = 0;
+  long i;
+
+  for(i = 0; i < n; i++)
+  {
+    int t = increment(d, rng);
+    q.insert(t, t);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(i = 0; i < holds; i++)
+  {
+    now = q.remove_front();
+    int t = now + increment(d, rng);
+    q.insert(t, t);
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(end - start).count() / holds;
+}
+
+int main(int argc, char ** argv)
+{
+  long holds = argc > 1 ? atol(argv[1]) : 5000000;
+  int sizes[] = { 100, 10000, 1000000 };
+  Distribution distributions[] = { Exponential, Uniform, Bimodal, Triangular };
+  int s, d;
+
+  std::cout << "distribution\tN\tPriorityQueue ns/hold\tCalendarQueue ns/hold" << std::endl;
+  for(d = 0; d < 4; d++)
+  {
+    for(s = 0; s < 3; s++)
+    {
+      std::cout << distributionName(distributions[d]) << "\t" << sizes[s]
+                << "\t" << hold<PriorityQueue<int> >(distributions[d], sizes[s], holds)
+                << "\t" << hold<CalendarQueue<int> >(distributions[d], sizes[s], holds)
+                << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+/***********************
+ * CalendarQueue test
+ * 1. Widely spaced priorities (0..5, 100, 1000000100, 2000000100), whose
+ *    gaps once gave a day width that overflowed int, popped in order
+ * 2. Random priorities over the whole non-negative int range, mixed with
+ *    change_priority, checked against a sorted copy
+ *
+ * Build: g++ -O2 -std=c++11 12750826CalendarQueueTest.cpp -o calendartest
+ * Run:   ./calendartest     (exit status 0 on success)
+ * *********************
+ */
+
+#include <iostream>
+#include <vector>
+#include <climits>
+#include <cstdlib>
+#include "12750826CalendarQueue.h"
+
+/*
+ * @return True if popping every element of "queue" gives each id in
+ *         "priorities" exactly once, in order of its priority there.
+ */
+bool popsInOrder(CalendarQueue<int> & queue, const std::vector<int> & priorities, int live)
+{
+  std::vector<bool> seen(priorities.size(), false);
+  int last = 0;
+  int i;
+
+  if(queue.size() != live) { return false; }
+  for(i = 0; i < live; i++)
+  {
+    int id = queue.remove_front();
+
+    if(id < 0 || id >= (int)priorities.size() || seen[id] || priorities[id] < last) { return false; }
+    seen[id] = true;
+    last = priorities[id];
+  }
+  return queue.empty();
+}
+
+int main()
+{
+  int failures = 0;
+  int i;
+
+  {
+    int spaced[] = { 0, 1, 2, 3, 4, 5, 100, 1000000100, 2000000100 };
+    std::vector<int> priorities(spaced, spaced + sizeof(spaced) / sizeof(spaced[0]));
+    CalendarQueue<int> queue;
+
+    for(i = 0; i < (int)priorities.size(); i++) { queue.insert(priorities[i], i); }
+    if(!popsInOrder(queue, priorities, priorities.size()))
+    {
+      std::cout << "FAIL: widely spaced priorities" << std::endl;
+      failures++;
+    }
+  }
+
+  {
+    std::vector<int> priorities;
+    CalendarQueue<int> queue;
+    int live = 0;
+
+    std::srand(12750826);
+    for(i = 0; i < 5000; i++)
+    {
+      int priority = (int)(((long long)std::rand() * RAND_MAX + std::rand()) % INT_MAX);
+      if(i % 3 == 0) { priority = INT_MAX - i; } // Keep some right at the top of the range.
+      queue.insert(priority, i);
+      priorities.push_back(priority);
+      live++;
+    }
+    for(i = 0; i < 1000; i++)
+    {
+      // Pop some before moving others, so the calendar shrinks in between.
+      int id = queue.remove_front();
+      priorities[id] = -1;
+      live--;
+    }
+    for(i = 0; i < (int)priorities.size(); i += 7)
+    {
+      if(priorities[i] < 0) { continue; }
+      priorities[i] = (int)(((long long)std::rand() * RAND_MAX + std::rand()) % INT_MAX);
+      queue.change_priority(i, priorities[i]);
+    }
+    for(i = 0; i < (int)priorities.size(); i++)
+    {
+      if(priorities[i] < 0) { priorities[i] = INT_MAX; } // Never popped again.
+    }
+    if(!popsInOrder(queue, priorities, live))
+    {
+      std::cout << "FAIL: random wide priorities" << std::endl;
+      failures++;
+    }
+  }
+
+  std::cout << (failures == 0 ? "PASS" : "FAILED") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
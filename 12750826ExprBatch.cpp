@@ -0,0 +1,261 @@
+#include "12750826ExprBatch.h"
+#include "12750826ExprLexer.h"
+#include "12750826ExprParser.h"
+#include "12750826ExprWriter.h"
+#include "12750826NodeArena.h"
+#include "ExprTree.h"
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const std::size_t ChunkBytes = 1 << 20;
+
+static void fail(const char * what)
+{
+  throw std::runtime_error(std::string(what) + ": " + strerror(errno));
+}
+
+/*
+ * A line-aligned piece of the input and the results for it.
+ */
+struct BatchChunk {
+  const char * begin;
+  const char * end;
+  std::vector<char> output;
+  long long lines;
+  bool ready;
+};
+
+/*
+ * State shared by the workers and the writer for one evaluateLines call.
+ */
+struct BatchPipeline {
+  std::vector<BatchChunk> chunks;
+  std::atomic<std::size_t> next; // Next chunk to hand to a worker.
+  std::size_t window;            // Chunks allowed past "written".
+
+  std::mutex lock;
+  std::condition_variable readyChanged;
+  std::condition_variable writtenChanged;
+  std::size_t written;           // Chunks handed to the output so far.
+};
+
+/*
+ * Written in place of the value of a line that divides by zero or
+ * INT_MIN by -1.
+ */
+static const char LineError[] = "error";
+
+/*
+ * @desc Evaluates every line of "chunk" into chunk.output, reusing the
+ *       worker's "tokens", "stacks" and "nodes".
+ */
+static void evaluateChunk(BatchChunk & chunk, std::vector<ExprToken> & tokens, ParseStacks & stacks, NodeArena & nodes)
+{
+  const char * line = chunk.begin;
+  std::size_t used = 0;
+
+  chunk.output.resize((chunk.end - chunk.begin) / 2 + 64);
+  chunk.lines = 0;
+  while(line < chunk.end)
+  {
+    const char * stop = static_cast<const char *>(memchr(line, '\n', chunk.end - line));
+    TreeNode * root = NULL;
+    int value;
+
+    if(stop == NULL) { stop = chunk.end; }
+
+    tokens.clear();
+    if(lexExpression(line, stop - line, tokens) > 0)
+    {
+      root = parseTokens(&tokens[0], &tokens[0] + tokens.size(), nodes, stacks);
+    }
+    if(chunk.output.size() - used < 12) { chunk.output.resize(chunk.output.size() * 2); }
+    if(ExprTree::evaluate(root, value))
+    {
+      used += formatInt(value, &chunk.output[used]);
+    }
+    else
+    {
+      memcpy(&chunk.output[used], LineError, sizeof(LineError) - 1);
+      used += sizeof(LineError) - 1;
+    }
+    chunk.output[used++] = '\n';
+    nodes.clear();
+
+    chunk.lines++;
+    line = stop + 1;
+  }
+  chunk.output.resize(used);
+}
+
+static void batchWorker(BatchPipeline & pipeline)
+{
+  std::vector<ExprToken> tokens;
+  ParseStacks stacks;
+  NodeArena nodes;
+  std::size_t i;
+
+  while((i = pipeline.next++) < pipeline.chunks.size())
+  {
+    {
+      std::unique_lock<std::mutex> guard(pipeline.lock);
+      pipeline.writtenChanged.wait(guard, [&]() { return i < pipeline.written + pipeline.window; });
+    }
+    evaluateChunk(pipeline.chunks[i], tokens, stacks, nodes);
+    {
+      std::lock_guard<std::mutex> guard(pipeline.lock);
+      pipeline.chunks[i].ready = true;
+    }
+    pipeline.readyChanged.notify_all();
+  }
+}
+
+/*
+ * @desc   Writes data[0, length) to "out", however many write() calls it takes.
+ * @return False if a write failed (errno says why).
+ */
+static bool writeFully(int out, const char * data, std::size_t length)
+{
+  while(length > 0)
+  {
+    ssize_t n = write(out, data, length);
+    if(n < 0 && errno == EINTR) { continue; }
+    if(n <= 0) { return false; }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+long long evaluateLines(const char * text, std::size_t length, int out, unsigned int threads)
+{
+  BatchPipeline pipeline;
+  std::vector<std::thread> workers;
+  const char * p = text;
+  const char * end = text + length;
+  long long lines = 0;
+  int error = 0;
+  std::size_t i;
+
+  if(threads == 0) { threads = std::thread::hardware_concurrency(); }
+  if(threads == 0) { threads = 1; }
+
+  // Cut the input into chunks that end just after a line break.
+  while(p < end)
+  {
+    BatchChunk chunk;
+    const char * stop = end;
+
+    if((std::size_t)(end - p) > ChunkBytes)
+    {
+      stop = static_cast<const char *>(memchr(p + ChunkBytes, '\n', end - p - ChunkBytes));
+      stop = stop == NULL ? end : stop + 1;
+    }
+    chunk.begin = p;
+    chunk.end = stop;
+    chunk.lines = 0;
+    chunk.ready = false;
+    pipeline.chunks.push_back(chunk);
+    p = stop;
+  }
+  pipeline.next = 0;
+  pipeline.window = 4 * threads;
+  pipeline.written = 0;
+
+  for(i = 0; i < threads; i++) { workers.push_back(std::thread(batchWorker, std::ref(pipeline))); }
+
+  // Write the chunks out in order as they complete. After a failed write
+  // the rest are still collected, so the workers can finish.
+  for(i = 0; i < pipeline.chunks.size(); i++)
+  {
+    BatchChunk & chunk = pipeline.chunks[i];
+    {
+      std::unique_lock<std::mutex> guard(pipeline.lock);
+      pipeline.readyChanged.wait(guard, [&]() { return chunk.ready; });
+    }
+    if(error == 0 && !writeFully(out, chunk.output.empty() ? NULL : &chunk.output[0], chunk.output.size()))
+    {
+      error = errno;
+    }
+    lines += chunk.lines;
+    std::vector<char>().swap(chunk.output);
+    {
+      std::lock_guard<std::mutex> guard(pipeline.lock);
+      pipeline.written = i + 1;
+    }
+    pipeline.writtenChanged.notify_all();
+  }
+
+  for(i = 0; i < workers.size(); i++) { workers[i].join(); }
+
+  if(error != 0)
+  {
+    errno = error;
+    fail("write");
+  }
+  return lines;
+}
+
+long long evaluateFile(const char * path, int out, unsigned int threads)
+{
+  std::vector<char> contents;
+  struct stat info;
+  void * mapped;
+  long long lines;
+  int in = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+
+  if(in < 0) { fail(path); }
+
+  if(fstat(in, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+  {
+    mapped = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, in, 0);
+    if(mapped != MAP_FAILED)
+    {
+      madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+      if(in != STDIN_FILENO) { close(in); }
+      try
+      {
+        lines = evaluateLines(static_cast<const char *>(mapped), info.st_size, out, threads);
+      }
+      catch(...)
+      {
+        munmap(mapped, info.st_size);
+        throw;
+      }
+      munmap(mapped, info.st_size);
+      return lines;
+    }
+  }
+
+  // Pipes and the like cannot be mapped: read them in instead.
+  for(;;)
+  {
+    std::size_t size = contents.size();
+    ssize_t n;
+
+    contents.resize(size + ChunkBytes);
+    n = read(in, &contents[size], ChunkBytes);
+    if(n < 0 && errno == EINTR) { n = 0; }
+    else if(n <= 0)
+    {
+      contents.resize(size);
+      if(n == 0) { break; }
+      if(in != STDIN_FILENO) { close(in); }
+      fail(path);
+    }
+    contents.resize(size + n);
+  }
+  if(in != STDIN_FILENO) { close(in); }
+  return evaluateLines(contents.empty() ? NULL : &contents[0], contents.size(), out, threads);
+}
@@ -0,0 +1,46 @@
+#ifndef _EXPR_BATCH_H
+#define _EXPR_BATCH_H
+
+/*
+ * Batch evaluation of files with one expression per line.
+ *
+ *   long long lines = evaluateFile("exprs.txt", STDOUT_FILENO);
+ *
+ * writes the value of every line, one per line and in input order, as
+ * ExprTree::buildTree(ExprTree::tokenise(line)).evaluateWholeTree() would
+ * compute it (an empty line gives 0). There are two differences:
+ *   - A literal too big for an int wraps, as in lexExpression, where
+ *     tokenise would turn a negative wrapped value into an unknown operator.
+ *   - A line that divides by zero, or INT_MIN by -1, gives "error" where
+ *     evaluate() would trap, and the lines after it are still evaluated.
+ *
+ * The input is mmap'd and cut into chunks of about ChunkBytes that end on
+ * a line break. Worker threads take chunks in turn and lex, parse and
+ * evaluate each line with per-thread token, parser and node buffers, so
+ * once those have grown to fit the longest line nothing is allocated per
+ * line. Results are formatted into a buffer per chunk.
+ * The calling thread writes the chunk buffers to the output in order as
+ * they complete, straight from where they were formatted. Only a bounded
+ * window of chunks is in flight at once, so memory use does not grow with
+ * the size of the input.
+ *
+ * Throws std::runtime_error if the input cannot be read or the output
+ * cannot be written. Link with -pthread.
+ */
+#include <cstddef>
+
+/*
+ * @desc   Evaluates every line of text[0, length) and writes the results
+ *         to file descriptor "out", using "threads" workers (0 means one
+ *         per hardware thread).
+ * @return The number of lines.
+ */
+long long evaluateLines(const char * text, std::size_t length, int out, unsigned int threads = 0);
+
+/*
+ * @desc   Like evaluateLines, for the contents of the file at "path"
+ *         ("-" reads standard input).
+ */
+long long evaluateFile(const char * path, int out, unsigned int threads = 0);
+
+#endif
@@ -0,0 +1,69 @@
+/***********************
+ * Batch expression evaluator
+ * 1. Reads a file with one expression per line ("-" for standard input)
+ * 2. Evaluates the lines on all cores (12750826ExprBatch.h)
+ * 3. Writes one result per line ("error" for a division by zero), in
+ *    input order, to the output file or standard output, and reports the
+ *    throughput on standard error
+ *
+ * Build: g++ -O2 -std=c++11 -pthread 12750826ExprBatchMain.cpp 12750826ExprBatch.cpp
+ *        12750826ExprTree.cpp 12750826ExprLexer.cpp 12750826ExprParser.cpp
+ *        12750826ExprVariables.cpp 12750826ExprWriter.cpp 12750826ExprBytecode.cpp
+ *        TreeNode.cpp -o exprbatch
+ * Run:   ./exprbatch input [output] [threads]
+ * *********************
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "12750826ExprBatch.h"
+
+int main(int argc, char ** argv)
+{
+  int out = STDOUT_FILENO;
+  unsigned int threads = argc > 3 ? atoi(argv[3]) : 0;
+  struct stat info;
+  long long lines;
+
+  if(argc < 2)
+  {
+    std::cerr << "usage: " << argv[0] << " input [output] [threads]" << std::endl;
+    return 2;
+  }
+  if(argc > 2 && std::string(argv[2]) != "-")
+  {
+    out = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(out < 0)
+    {
+      std::cerr << argv[2] << ": cannot open for writing" << std::endl;
+      return 1;
+    }
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  try
+  {
+    lines = evaluateFile(argv[1], out, threads);
+  }
+  catch(const std::runtime_error & e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if(out != STDOUT_FILENO) { close(out); }
+  std::cerr << lines << " lines in " << seconds << " s (" << lines / seconds / 1e6 << " M lines/s";
+  if(stat(argv[1], &info) == 0 && S_ISREG(info.st_mode))
+  {
+    std::cerr << ", " << info.st_size / seconds / 1e6 << " MB/s";
+  }
+  std::cerr << ")" << std::endl;
+
+  return 0;
+}
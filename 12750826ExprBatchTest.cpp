@@ -0,0 +1,98 @@
+/***********************
+ * Batch evaluator test
+ * 1. Evaluates lines that divide by zero and INT_MIN by -1 among good
+ *    ones, and checks that only those lines give "error"
+ * 2. Checks that evaluating 20000 lines makes no more allocations than
+ *    evaluating 20 of the same lines
+ *
+ * Build: g++ -O2 -std=c++11 -pthread 12750826ExprBatchTest.cpp 12750826ExprBatch.cpp
+ *        12750826ExprTree.cpp 12750826ExprLexer.cpp 12750826ExprParser.cpp
+ *        12750826ExprVariables.cpp 12750826ExprWriter.cpp 12750826ExprBytecode.cpp
+ *        TreeNode.cpp -o batchtest
+ * Run:   ./batchtest     (exit status 0 on success)
+ * *********************
+ */
+
+#include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "12750826ExprBatch.h"
+
+static std::atomic<long> allocations(0);
+
+void * operator new(std::size_t size)
+{
+  void * p = std::malloc(size == 0 ? 1 : size);
+
+  if(p == NULL) { throw std::bad_alloc(); }
+  allocations++;
+  return p;
+}
+
+void operator delete(void * p) noexcept { std::free(p); }
+
+/*
+ * @return What evaluateLines writes for "text" with "threads" workers.
+ */
+std::string evaluateToString(const std::string & text, unsigned int threads)
+{
+  std::FILE * file = std::tmpfile();
+  std::string output;
+  char buffer[4096];
+  std::size_t n;
+
+  evaluateLines(text.data(), text.size(), fileno(file), threads);
+  std::rewind(file);
+  while((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) { output.append(buffer, n); }
+  std::fclose(file);
+  return output;
+}
+
+/*
+ * @return Allocations made by evaluateLines for "lines" copies of "line".
+ */
+long allocationsFor(const std::string & line, int lines)
+{
+  std::FILE * sink = std::fopen("/dev/null", "w");
+  std::string text;
+  long before;
+  int i;
+
+  for(i = 0; i < lines; i++) { text += line; }
+  before = allocations;
+  evaluateLines(text.data(), text.size(), fileno(sink), 1);
+  before = allocations - before;
+  std::fclose(sink);
+  return before;
+}
+
+int main()
+{
+  const std::string input = "1+2\n7/0\n3*3\n(0-2147483647-1)/(0-1)\n8/(2-2)\n(0-2147483647-1)/2\n\n";
+  const std::string expected = "3\nerror\n9\nerror\nerror\n-1073741824\n0\n";
+  int failures = 0;
+
+  if(evaluateToString(input, 1) != expected || evaluateToString(input, 4) != expected)
+  {
+    std::cout << "FAIL: lines that trap" << std::endl;
+    failures++;
+  }
+
+  {
+    const std::string line = "(12 + 34) * (56 - 7) / 8 - 9 * (1 + 2 * (3 + 4))\n";
+    long few = allocationsFor(line, 20);
+    long many = allocationsFor(line, 20000);
+
+    if(many > few)
+    {
+      std::cout << "FAIL: " << few << " allocations for 20 lines, " << many << " for 20000" << std::endl;
+      failures++;
+    }
+  }
+
+  std::cout << (failures == 0 ? "PASS" : "FAILED") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,420 @@
+#include "12750826ExprBinary.h"
+#include "12750826ExprVariables.h"
+#include "12750826NodeArena.h"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Node kinds, in the low bits of a node word.
+ */
+enum BinaryKind { LiteralKind, PlusKind, MinusKind, TimesKind, DivideKind, NoOpKind, VariableKind };
+
+static const unsigned int KindMask = 7;
+static const unsigned int HasLeft = 8;
+static const unsigned int HasRight = 16;
+static const int OffsetShift = 5;
+static const unsigned int MaxNodes = 1u << (32 - OffsetShift);
+
+struct BinaryHeader {
+  char magic[4];
+  unsigned int count;
+  unsigned int nameCount;
+  unsigned int unused;
+  unsigned long long namesOffset;
+};
+
+/*
+ * Start of each formula record; the nodes follow.
+ */
+struct FormulaHeader {
+  unsigned int nodeCount;
+  unsigned int literalBytes;
+  unsigned int depth;
+};
+
+static void corrupt(const char * what)
+{
+  throw std::runtime_error(std::string("corrupt expression file: ") + what);
+}
+
+/*
+ * @return True if all "count" items of "size" bytes at "data" were written.
+ *         Nothing is passed to fwrite when there is nothing to write, as
+ *         an empty vector's data() may be NULL.
+ */
+static bool writeItems(FILE * out, const void * data, std::size_t size, std::size_t count)
+{
+  return count == 0 || fwrite(data, size, count, out) == count;
+}
+
+static void putVarint(std::vector<unsigned char> & out, unsigned long long value)
+{
+  while(value >= 0x80)
+  {
+    out.push_back((unsigned char)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((unsigned char)value);
+}
+
+/*
+ * @desc Reads a varint at p (not past end) and moves p after it.
+ */
+static unsigned long long getVarint(const unsigned char * & p, const unsigned char * end)
+{
+  unsigned long long value = 0;
+  int shift = 0;
+
+  for(;;)
+  {
+    if(p == end || shift > 63) { corrupt("literal runs past its formula"); }
+    value |= (unsigned long long)(*p & 0x7f) << shift;
+    if(!(*p++ & 0x80)) { return value; }
+    shift += 7;
+  }
+}
+
+static unsigned int zigzag(int value) { return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31); }
+
+static int unzigzag(unsigned long long value) { return (int)((unsigned int)(value >> 1) ^ (0u - (unsigned int)(value & 1))); }
+
+void ExprBinaryWriter::add(TreeNode * root)
+{
+  // Post-order walk; "last" is the node number of the subtree just
+  // finished, and "depth" the stack depth evaluation will have reached.
+  struct Frame { TreeNode * node; int stage; unsigned int left; };
+  std::vector<Frame> frames;
+  std::vector<unsigned int> nodes;
+  std::vector<unsigned char> literals;
+  unsigned int last = 0;
+  unsigned int depth = 0, maxDepth = 0;
+  FormulaHeader header;
+
+  if(root != NULL)
+  {
+    Frame first = { root, 0, 0 };
+    frames.push_back(first);
+  }
+  while(!frames.empty())
+  {
+    Frame & frame = frames.back();
+    bool variable = isVariable(frame.node);
+    TreeNode * child = NULL;
+    unsigned int word = 0;
+
+    if(!variable && frame.stage < 2)
+    {
+      child = frame.stage == 0 ? frame.node->getLeftChild() : frame.node->getRightChild();
+      if(frame.stage == 1) { frame.left = last; }
+      frame.stage++;
+      if(child != NULL)
+      {
+        Frame next = { child, 0, 0 };
+        frames.push_back(next); // frame is invalid from here.
+      }
+      continue;
+    }
+
+    if(nodes.size() == MaxNodes) { throw std::runtime_error("expression too large for the binary format"); }
+
+    if(variable)
+    {
+      int id = variableOf(frame.node);
+      std::unordered_map<int, unsigned int>::iterator found = nameIndex.find(id);
+
+      if(found == nameIndex.end())
+      {
+        found = nameIndex.insert(std::make_pair(id, (unsigned int)names.size())).first;
+        names.push_back(variableName(id));
+      }
+      word = VariableKind;
+      putVarint(literals, found->second);
+      depth++;
+    }
+    else if(!frame.node->isOperator())
+    {
+      word = LiteralKind;
+      putVarint(literals, zigzag(frame.node->getValue()));
+      depth++;
+    }
+    else
+    {
+      TreeNode * left = frame.node->getLeftChild();
+      TreeNode * right = frame.node->getRightChild();
+
+      switch(frame.node->getOperator())
+      {
+        case Plus   : word = PlusKind; break;
+        case Minus  : word = MinusKind; break;
+        case Times  : word = TimesKind; break;
+        case Divide : word = DivideKind; break;
+        default     : word = NoOpKind; break;
+      }
+      if(left != NULL) { word |= HasLeft | ((unsigned int)nodes.size() - frame.left) << OffsetShift; }
+      if(right != NULL) { word |= HasRight; }
+      // Pops the operands it has, pushes its result.
+      depth = depth - (left != NULL) - (right != NULL) + 1;
+    }
+    if(depth > maxDepth) { maxDepth = depth; }
+
+    last = nodes.size();
+    nodes.push_back(word);
+    frames.pop_back();
+  }
+
+  header.nodeCount = nodes.size();
+  header.literalBytes = literals.size();
+  header.depth = maxDepth;
+
+  while(formulas.size() % 4 != 0) { formulas.push_back(0); }
+  offsets.push_back(formulas.size());
+  formulas.insert(formulas.end(), (unsigned char *)&header, (unsigned char *)(&header + 1));
+  if(!nodes.empty())
+  {
+    formulas.insert(formulas.end(), (unsigned char *)&nodes[0], (unsigned char *)(&nodes[0] + nodes.size()));
+  }
+  formulas.insert(formulas.end(), literals.begin(), literals.end());
+}
+
+void ExprBinaryWriter::save(const std::string & path) const
+{
+  BinaryHeader header;
+  std::vector<unsigned long long> fileOffsets(offsets.size());
+  std::vector<unsigned char> nameTable;
+  unsigned long long start = sizeof(header) + offsets.size() * sizeof(unsigned long long);
+  std::size_t i;
+  FILE * out;
+  bool ok;
+
+  for(i = 0; i < offsets.size(); i++) { fileOffsets[i] = start + offsets[i]; }
+  for(i = 0; i < names.size(); i++)
+  {
+    putVarint(nameTable, names[i].size());
+    nameTable.insert(nameTable.end(), names[i].begin(), names[i].end());
+  }
+
+  std::memcpy(header.magic, "EXB1", 4);
+  header.count = offsets.size();
+  header.nameCount = names.size();
+  header.unused = 0;
+  header.namesOffset = start + formulas.size();
+
+  out = fopen(path.c_str(), "wb");
+  if(out == NULL) { throw std::runtime_error(path + ": " + strerror(errno)); }
+  ok = writeItems(out, &header, sizeof(header), 1)
+    && writeItems(out, fileOffsets.data(), sizeof(unsigned long long), fileOffsets.size())
+    && writeItems(out, formulas.data(), 1, formulas.size())
+    && writeItems(out, nameTable.data(), 1, nameTable.size());
+  ok = fclose(out) == 0 && ok;
+  if(!ok) { throw std::runtime_error(path + ": write failed"); }
+}
+
+ExprBinaryFile::ExprBinaryFile(const std::string & path) : base(0), bytes(0), count(0), offsets(0)
+{
+  const BinaryHeader * header;
+  const unsigned char * p;
+  const unsigned char * end;
+  struct stat info;
+  void * mapped;
+  unsigned int i;
+  int fd = open(path.c_str(), O_RDONLY);
+
+  if(fd < 0) { throw std::runtime_error(path + ": " + strerror(errno)); }
+  if(fstat(fd, &info) != 0 || (std::size_t)info.st_size < sizeof(BinaryHeader))
+  {
+    close(fd);
+    corrupt("too short");
+  }
+  mapped = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mapped == MAP_FAILED) { throw std::runtime_error(path + ": " + strerror(errno)); }
+  base = static_cast<const unsigned char *>(mapped);
+  bytes = info.st_size;
+
+  try
+  {
+    header = reinterpret_cast<const BinaryHeader *>(base);
+    if(std::memcmp(header->magic, "EXB1", 4) != 0) { corrupt("bad magic"); }
+    count = header->count;
+    if(count > (bytes - sizeof(BinaryHeader)) / sizeof(unsigned long long)) { corrupt("offset table runs past the end"); }
+    offsets = reinterpret_cast<const unsigned long long *>(base + sizeof(BinaryHeader));
+    if(header->namesOffset > bytes) { corrupt("name table runs past the end"); }
+
+    // The names are few, so they are read now rather than on every use.
+    p = base + header->namesOffset;
+    end = base + bytes;
+    for(i = 0; i < header->nameCount; i++)
+    {
+      unsigned long long length = getVarint(p, end);
+      if(length > (unsigned long long)(end - p)) { corrupt("name runs past the end"); }
+      names.push_back(std::string((const char *)p, length));
+      p += length;
+    }
+  }
+  catch(...)
+  {
+    munmap(mapped, bytes);
+    throw;
+  }
+}
+
+ExprBinaryFile::~ExprBinaryFile()
+{
+  if(base) { munmap((void *)base, bytes); }
+}
+
+ExprBinaryFile::Formula ExprBinaryFile::formula(std::size_t index) const
+{
+  const FormulaHeader * header;
+  unsigned long long offset;
+  Formula f;
+
+  if(index >= count) { throw std::out_of_range("no such formula"); }
+  offset = offsets[index];
+  if(offset % 4 != 0 || offset > bytes || bytes - offset < sizeof(FormulaHeader)) { corrupt("bad formula offset"); }
+
+  header = reinterpret_cast<const FormulaHeader *>(base + offset);
+  if((bytes - offset - sizeof(FormulaHeader)) / 4 < header->nodeCount) { corrupt("nodes run past the end"); }
+  f.nodes = reinterpret_cast<const unsigned int *>(header + 1);
+  f.nodeCount = header->nodeCount;
+  f.depth = header->depth;
+  if(f.depth > f.nodeCount) { corrupt("bad stack depth"); }
+  f.literals = reinterpret_cast<const unsigned char *>(f.nodes + f.nodeCount);
+  if((std::size_t)(base + bytes - f.literals) < header->literalBytes) { corrupt("literals run past the end"); }
+  f.literalsEnd = f.literals + header->literalBytes;
+  return f;
+}
+
+int ExprBinaryFile::evaluate(std::size_t index) const
+{
+  Formula f = formula(index);
+  int local[64];
+  std::vector<int> spill;
+  int * stack = local;
+  const unsigned char * literal = f.literals;
+  unsigned int top = 0; // Values on the stack.
+  unsigned int i;
+
+  if(f.depth > 64)
+  {
+    spill.resize(f.depth);
+    stack = &spill[0];
+  }
+
+  for(i = 0; i < f.nodeCount; i++)
+  {
+    unsigned int word = f.nodes[i];
+    unsigned int kind = word & KindMask;
+    int left = 0, right = 0;
+
+    if(kind == LiteralKind || kind == VariableKind)
+    {
+      unsigned long long operand = getVarint(literal, f.literalsEnd);
+      if(top == f.depth) { corrupt("stack overflow"); }
+      stack[top++] = kind == LiteralKind ? unzigzag(operand) : 0;
+      continue;
+    }
+
+    if(word & HasRight)
+    {
+      if(top == 0) { corrupt("stack underflow"); }
+      right = stack[--top];
+    }
+    if(word & HasLeft)
+    {
+      if(top == 0) { corrupt("stack underflow"); }
+      left = stack[--top];
+    }
+    switch(kind)
+    {
+      case PlusKind   : left = left + right; break;
+      case MinusKind  : left = left - right; break;
+      case TimesKind  : left = left * right; break;
+      case DivideKind :
+        if(right == 0 || (left == INT_MIN && right == -1))
+        {
+          throw std::runtime_error("division by zero or overflow in formula");
+        }
+        left = left / right;
+        break;
+      default         : left = 0; break;
+    }
+    if(top == f.depth) { corrupt("stack overflow"); }
+    stack[top++] = left;
+  }
+
+  if(f.nodeCount == 0) { return 0; }
+  if(top != 1) { corrupt("unbalanced formula"); }
+  return stack[0];
+}
+
+ExprTree ExprBinaryFile::load(std::size_t index) const
+{
+  Formula f = formula(index);
+  NodeArena arena;
+  std::vector<TreeNode *> stack;
+  const unsigned char * literal = f.literals;
+  unsigned int i;
+
+  stack.reserve(f.depth);
+  for(i = 0; i < f.nodeCount; i++)
+  {
+    unsigned int word = f.nodes[i];
+    TreeNode * node;
+    TreeNode * left = NULL;
+    TreeNode * right = NULL;
+
+    switch(word & KindMask)
+    {
+      case LiteralKind :
+        stack.push_back(arena.create(unzigzag(getVarint(literal, f.literalsEnd))));
+        continue;
+
+      case VariableKind :
+      {
+        unsigned long long name = getVarint(literal, f.literalsEnd);
+        int id;
+
+        if(name >= names.size()) { corrupt("bad variable"); }
+        id = variableId(names[name]);
+        if(id < 0) { throw std::runtime_error("too many variable names to load formula"); }
+        stack.push_back(createVariableNode(id, arena));
+        continue;
+      }
+
+      case PlusKind   : node = arena.create(Plus); break;
+      case MinusKind  : node = arena.create(Minus); break;
+      case TimesKind  : node = arena.create(Times); break;
+      case DivideKind : node = arena.create(Divide); break;
+      default         : node = arena.create(NoOp); break;
+    }
+    if(word & HasRight)
+    {
+      if(stack.empty()) { corrupt("stack underflow"); }
+      right = stack.back();
+      stack.pop_back();
+    }
+    if(word & HasLeft)
+    {
+      if(stack.empty()) { corrupt("stack underflow"); }
+      left = stack.back();
+      stack.pop_back();
+    }
+    node->setLeftChild(left);
+    node->setRightChild(right);
+    if(left) { left->setParent(node); }
+    if(right) { right->setParent(node); }
+    stack.push_back(node);
+  }
+
+  if(f.nodeCount == 0) { return ExprTree(); }
+  if(stack.size() != 1) { corrupt("unbalanced formula"); }
+  return ExprTree(stack[0], std::move(arena));
+}
@@ -0,0 +1,118 @@
+#ifndef _EXPR_BINARY_H
+#define _EXPR_BINARY_H
+
+/*
+ * Compact binary files of expressions that are used straight from an
+ * mmap'd file, with no parsing and no heap nodes.
+ *
+ *   ExprBinaryWriter out;
+ *   out.add(tree.getRoot());          // Any number of formulas...
+ *   out.save("formulas.exb");
+ *
+ *   ExprBinaryFile in("formulas.exb"); // ...later: one mmap call.
+ *   int result = in.evaluate(i);       // Formula i, read in place.
+ *   ExprTree copy = in.load(i);        // Or back to an ExprTree.
+ *
+ * File layout (host byte order, so files move between little-endian
+ * machines only):
+ *
+ *   header   "EXB1", formula count, name count, offset of the name table
+ *   offsets  one 64-bit file offset per formula
+ *   formulas each 4-byte aligned: node count, literal bytes, stack depth,
+ *            then the nodes, then the literals
+ *   names    the variable names, each a varint length and the bytes
+ *
+ * A formula's nodes are one 32-bit word each, in post order: the kind
+ * (literal, variable, an operator or NoOp) in the low 3 bits, a bit each
+ * for whether the node has a left and a right child, and in the rest the
+ * distance back to the left child; the right child is always the node
+ * just before. Literals and variables take their operand, in node order,
+ * from the literal bytes: zigzag varints, which are a single byte for
+ * most numbers in real formulas, holding the value or the index of the
+ * variable's name. Evaluation is then one forward pass over both arrays
+ * with a small value stack, like CompiledExpr's.
+ *
+ * Variables evaluate to 0 here, as in ExprTree::evaluate; load() turns
+ * them back into variables of this process. Errors, including a file
+ * that is not well formed, throw std::runtime_error. So does evaluating a
+ * division by zero or INT_MIN / -1, where ExprTree::evaluate would trap.
+ */
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ExprTree.h"
+
+class ExprBinaryWriter {
+
+private:
+
+  std::vector<unsigned char> formulas; // Formula records, back to back.
+  std::vector<unsigned long long> offsets; // Of each record in "formulas".
+  std::vector<std::string> names;
+  std::unordered_map<int, unsigned int> nameIndex; // Variable id -> names.
+
+public:
+
+  /*
+   * @desc Appends the expression under "root" (which may be NULL).
+   */
+  void add(TreeNode * root);
+
+  /*
+   * @desc Writes everything added so far to "path".
+   */
+  void save(const std::string & path) const;
+
+  std::size_t size() const { return offsets.size(); }
+};
+
+class ExprBinaryFile {
+
+private:
+
+  const unsigned char * base; // The mapping; a file too short for a header is rejected.
+  std::size_t bytes;
+  std::size_t count;
+  const unsigned long long * offsets;
+  std::vector<std::string> names;
+
+  struct Formula {
+    const unsigned int * nodes;
+    const unsigned char * literals;
+    const unsigned char * literalsEnd;
+    unsigned int nodeCount;
+    unsigned int depth;
+  };
+
+  Formula formula(std::size_t index) const;
+
+public:
+
+  /*
+   * @desc Maps the file at "path" read-only and checks its layout.
+   */
+  explicit ExprBinaryFile(const std::string & path);
+
+  ~ExprBinaryFile();
+
+  ExprBinaryFile(const ExprBinaryFile &) = delete;
+  ExprBinaryFile & operator=(const ExprBinaryFile &) = delete;
+
+  std::size_t size() const { return count; }
+
+  /*
+   * @desc  Evaluates formula "index" in place, giving the same result as
+   *        ExprTree::evaluate on the tree it was written from. Throws
+   *        std::runtime_error where that would trap.
+   */
+  int evaluate(std::size_t index) const;
+
+  /*
+   * @desc Rebuilds formula "index" as an ExprTree.
+   */
+  ExprTree load(std::size_t index) const;
+};
+
+#endif
@@ -0,0 +1,512 @@
+#include "12750826ExprBytecode.h"
+#include "12750826ExprVariables.h"
+#include <cstring>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+ * Below this many stack slots evaluate() uses a local array instead of
+ * allocating.
+ */
+static const int LocalStackSize = 64;
+
+/*
+ * Rows evaluate_batch works on at a time; a block of every stack level
+ * stays in L1.
+ */
+static const std::size_t BatchBlock = 256;
+
+/*
+ * a * 2^shift, wrapping like a multiply would.
+ */
+static inline int shiftLeft(int a, int shift)
+{
+  return (int)((unsigned int)a << shift);
+}
+
+/*
+ * a / d for the constant d that "magic" and "shift" were made for: the
+ * quotient of |a| is (|a| * magic) >> shift, and takes the sign of a.
+ */
+static inline int divideMagic(int a, unsigned int magic, int shift)
+{
+  unsigned int absolute = a < 0 ? 0u - (unsigned int)a : (unsigned int)a;
+  unsigned int quotient = (unsigned int)(((unsigned long long)absolute * magic) >> shift);
+
+  return a < 0 ? -(int)quotient : (int)quotient;
+}
+
+CompiledExpr::CompiledExpr() : maxDepth(1), temps(0)
+{
+  Instruction push = { PushOp, 0, 0 };
+  Instruction end = { EndOp, 0, 0 };
+
+  code.push_back(push);
+  code.push_back(end);
+}
+
+/*
+ * Adds the operator nodes under "root" that are used more than once to
+ * "shared". Uses are counted per visit rather than read from the parent
+ * links, so a node that is both operands of one parent ("X * X") counts
+ * twice; each node is only descended into on its first use.
+ */
+static void findShared(TreeNode * root, std::unordered_map<TreeNode *, int> & shared)
+{
+  std::vector<TreeNode *> pending(1, root);
+  std::unordered_map<TreeNode *, int> uses;
+  int i;
+
+  while(!pending.empty())
+  {
+    TreeNode * node = pending.back();
+    TreeNode * children[2] = { node->getLeftChild(), node->getRightChild() };
+    pending.pop_back();
+
+    for(i = 0; i < 2; i++)
+    {
+      TreeNode * child = children[i];
+
+      if(child == NULL || !child->isOperator() || isVariable(child)) { continue; }
+      if(++uses[child] == 1) { pending.push_back(child); }
+      else { shared[child] = -1; }
+    }
+  }
+}
+
+CompiledExpr::CompiledExpr(TreeNode * root) : maxDepth(0), temps(0)
+{
+  Instruction end = { EndOp, 0, 0 };
+  std::unordered_map<TreeNode *, int> shared; // Temporary of each shared node, -1 until emitted.
+
+  if(root) { findShared(root, shared); }
+  emit(root, shared);
+  code.push_back(end);
+}
+
+/*
+ * A node waiting to be emitted: its value ends up at stack position
+ * "depth", and "childrenDone" is set once its operands have been emitted.
+ */
+struct EmitFrame {
+  TreeNode * node;
+  int depth;
+  bool childrenDone;
+};
+
+/*
+ * Appends the postfix code for the tree under "root". A missing child
+ * evaluates to 0, like in evaluate(). Uses an explicit stack, so any
+ * depth of tree compiles.
+ */
+void CompiledExpr::emit(TreeNode * root, std::unordered_map<TreeNode *, int> & shared)
+{
+  std::vector<EmitFrame> pending;
+  EmitFrame first = { root, 1, false };
+
+  pending.push_back(first);
+  while(!pending.empty())
+  {
+    EmitFrame frame = pending.back();
+    TreeNode * node = frame.node;
+    Instruction instruction = { PushOp, 0, 0 };
+    pending.pop_back();
+
+    if(frame.depth > maxDepth) { maxDepth = frame.depth; }
+
+    if(isVariable(node))
+    {
+      instruction.code = LoadOp;
+      instruction.operand = slotOf(variableOf(node));
+      code.push_back(instruction);
+      continue;
+    }
+
+    if(node == NULL || !node->isOperator())
+    {
+      instruction.operand = node == NULL ? 0 : node->getValue();
+      code.push_back(instruction);
+      continue;
+    }
+
+    std::unordered_map<TreeNode *, int>::iterator memo = shared.find(node);
+    if(memo != shared.end() && memo->second >= 0)
+    {
+      instruction.code = TempOp;
+      instruction.operand = memo->second;
+      code.push_back(instruction);
+      continue;
+    }
+
+    TreeNode * right = node->getRightChild();
+    bool literal = right != NULL && !right->isOperator();
+
+    if(!frame.childrenDone)
+    {
+      EmitFrame leftFrame = { node->getLeftChild(), frame.depth, false };
+      EmitFrame rightFrame = { right, frame.depth + 1, false };
+
+      frame.childrenDone = true;
+      pending.push_back(frame);
+      if(!literal) { pending.push_back(rightFrame); }
+      pending.push_back(leftFrame);
+      continue;
+    }
+
+    // A literal right operand is folded into the instruction ("x * 3" is
+    // one MulConst 3 instead of Push 3, Mul).
+    if(literal) { instruction.operand = right->getValue(); }
+    switch(node->getOperator())
+    {
+      case Plus   : instruction.code = literal ? AddConstOp : AddOp; break;
+      case Minus  : instruction.code = literal ? SubConstOp : SubOp; break;
+      case Times  : instruction.code = literal ? MulConstOp : MulOp; break;
+      case Divide : instruction.code = literal ? DivConstOp : DivOp; break;
+      default     : instruction.code = literal ? ZeroConstOp : ZeroOp; break;
+    }
+    code.push_back(instruction);
+
+    if(memo != shared.end())
+    {
+      instruction.code = TeeOp;
+      instruction.operand = memo->second = temps++;
+      code.push_back(instruction);
+    }
+  }
+}
+
+/*
+ * Returns the slot for variable "id", giving it the next one if it is new.
+ */
+int CompiledExpr::slotOf(int id)
+{
+  std::size_t slot;
+
+  for(slot = 0; slot < variables.size(); slot++)
+  {
+    if(variables[slot] == id) { return slot; }
+  }
+  variables.push_back(id);
+  return variables.size() - 1;
+}
+
+int CompiledExpr::variable_slot(const std::string & name) const
+{
+  int id = variableId(name);
+  std::size_t slot;
+
+  for(slot = 0; slot < variables.size(); slot++)
+  {
+    if(variables[slot] == id) { return slot; }
+  }
+  return -1;
+}
+
+std::string CompiledExpr::variable_name(int slot) const
+{
+  if(slot < 0 || slot >= (int)variables.size()) { return ""; }
+  return variableName(variables[slot]);
+}
+
+int CompiledExpr::evaluate() const
+{
+  if(variables.empty()) { return evaluate(NULL); }
+
+  std::vector<int> zeros(variables.size(), 0);
+  return evaluate(&zeros[0]);
+}
+
+int CompiledExpr::evaluate(const int * values) const
+{
+  int local[LocalStackSize];
+  int localTemps[LocalStackSize];
+  std::vector<int> heap, heapTemps;
+  int * stack = local;
+  int * temp = localTemps;
+  int * top;                 // Second value from the top.
+  int value = 0;             // Top of the stack, kept in a register.
+  const Instruction * ip = &code[0];
+
+  if(maxDepth > LocalStackSize)
+  {
+    heap.resize(maxDepth);
+    stack = &heap[0];
+  }
+  if(temps > LocalStackSize)
+  {
+    heapTemps.resize(temps);
+    temp = &heapTemps[0];
+  }
+  top = stack - 1;
+
+#if defined(__GNUC__)
+  // Computed goto: each handler jumps straight to the next one.
+  static const void * const dispatch[] = {
+    &&push, &&load, &&add, &&sub, &&mul, &&div, &&zero,
+    &&addConst, &&subConst, &&mulConst, &&divConst, &&zeroConst,
+    &&shlConst, &&divMagic, &&tee, &&temp, &&end
+  };
+#define NEXT goto *dispatch[(ip++)->code]
+
+  NEXT;
+push:
+  *++top = value;
+  value = ip[-1].operand;
+  NEXT;
+load:
+  *++top = value;
+  value = values[ip[-1].operand];
+  NEXT;
+add:
+  value = *top-- + value;
+  NEXT;
+sub:
+  value = *top-- - value;
+  NEXT;
+mul:
+  value = *top-- * value;
+  NEXT;
+div:
+  value = *top-- / value;
+  NEXT;
+zero:
+  value = 0; top--;
+  NEXT;
+addConst:
+  value += ip[-1].operand;
+  NEXT;
+subConst:
+  value -= ip[-1].operand;
+  NEXT;
+mulConst:
+  value *= ip[-1].operand;
+  NEXT;
+divConst:
+  value /= ip[-1].operand;
+  NEXT;
+zeroConst:
+  value = 0;
+  NEXT;
+shlConst:
+  value = shiftLeft(value, ip[-1].shift);
+  NEXT;
+divMagic:
+  value = divideMagic(value, ip[-1].operand, ip[-1].shift);
+  NEXT;
+tee:
+  temp[ip[-1].operand] = value;
+  NEXT;
+temp:
+  *++top = value;
+  value = temp[ip[-1].operand];
+  NEXT;
+end:
+  return value;
+#undef NEXT
+#else
+  for(;;)
+  {
+    switch(ip->code)
+    {
+      case PushOp : *++top = value; value = ip->operand; break;
+      case LoadOp : *++top = value; value = values[ip->operand]; break;
+      case AddOp  : value = *top-- + value; break;
+      case SubOp  : value = *top-- - value; break;
+      case MulOp  : value = *top-- * value; break;
+      case DivOp  : value = *top-- / value; break;
+      case ZeroOp : value = 0; top--; break;
+      case AddConstOp  : value += ip->operand; break;
+      case SubConstOp  : value -= ip->operand; break;
+      case MulConstOp  : value *= ip->operand; break;
+      case DivConstOp  : value /= ip->operand; break;
+      case ZeroConstOp : value = 0; break;
+      case ShlConstOp  : value = shiftLeft(value, ip->shift); break;
+      case DivMagicOp  : value = divideMagic(value, ip->operand, ip->shift); break;
+      case TeeOp  : temp[ip->operand] = value; break;
+      case TempOp : *++top = value; value = temp[ip->operand]; break;
+      case EndOp  : return value;
+    }
+    ip++;
+  }
+#endif
+}
+
+/*
+ * Per-operator lane arithmetic for evaluate_batch: scalar() for one row,
+ * vector() for 8 rows in an AVX2 register.
+ */
+struct AddLanes {
+  static int scalar(int a, int b) { return a + b; }
+#ifdef __AVX2__
+  static __m256i vector(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+#endif
+};
+
+struct SubLanes {
+  static int scalar(int a, int b) { return a - b; }
+#ifdef __AVX2__
+  static __m256i vector(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+#endif
+};
+
+struct MulLanes {
+  static int scalar(int a, int b) { return a * b; }
+#ifdef __AVX2__
+  static __m256i vector(__m256i a, __m256i b) { return _mm256_mullo_epi32(a, b); }
+#endif
+};
+
+struct DivLanes {
+  static int scalar(int a, int b) { return a / b; }
+#ifdef __AVX2__
+  // There is no integer divide; the quotient of two 32-bit ints in double
+  // precision truncates to exactly the integer quotient.
+  static __m128i half(__m128i a, __m128i b)
+  {
+    return _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(a), _mm256_cvtepi32_pd(b)));
+  }
+  static __m256i vector(__m256i a, __m256i b)
+  {
+    __m128i low = half(_mm256_castsi256_si128(a), _mm256_castsi256_si128(b));
+    __m128i high = half(_mm256_extracti128_si256(a, 1), _mm256_extracti128_si256(b, 1));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+  }
+#endif
+};
+
+/*
+ * out[i] = a[i] op b[i] for i < n. out may be a or b.
+ */
+template <typename Lanes>
+static void applyColumns(const int * a, const int * b, int * out, std::size_t n)
+{
+  std::size_t i = 0;
+
+#ifdef __AVX2__
+  for(; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    _mm256_storeu_si256((__m256i *)(out + i), Lanes::vector(x, y));
+  }
+#endif
+  for(; i < n; i++) { out[i] = Lanes::scalar(a[i], b[i]); }
+}
+
+/*
+ * out[i] = a[i] op k for i < n. out may be a.
+ */
+template <typename Lanes>
+static void applyConstant(const int * a, int k, int * out, std::size_t n)
+{
+  std::size_t i = 0;
+
+#ifdef __AVX2__
+  __m256i y = _mm256_set1_epi32(k);
+  for(; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    _mm256_storeu_si256((__m256i *)(out + i), Lanes::vector(x, y));
+  }
+#endif
+  for(; i < n; i++) { out[i] = Lanes::scalar(a[i], k); }
+}
+
+/*
+ * out[i] = a[i] * 2^shift for i < n. out may be a.
+ */
+static void applyShift(const int * a, int shift, int * out, std::size_t n)
+{
+  std::size_t i = 0;
+
+#ifdef __AVX2__
+  __m128i count = _mm_cvtsi32_si128(shift);
+  for(; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_sll_epi32(x, count));
+  }
+#endif
+  for(; i < n; i++) { out[i] = shiftLeft(a[i], shift); }
+}
+
+/*
+ * out[i] = divideMagic(a[i], magic, shift) for i < n. out may be a.
+ */
+static void applyMagic(const int * a, unsigned int magic, int shift, int * out, std::size_t n)
+{
+  std::size_t i = 0;
+
+#ifdef __AVX2__
+  // 32x32->64 multiplies only exist for the even lanes, so the odd lanes
+  // are moved down, multiplied separately and blended back.
+  __m256i m = _mm256_set1_epi32((int)magic);
+  __m128i count = _mm_cvtsi32_si128(shift);
+  for(; i + 8 <= n; i += 8)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i absolute = _mm256_abs_epi32(x);
+    __m256i even = _mm256_srl_epi64(_mm256_mul_epu32(absolute, m), count);
+    __m256i odd = _mm256_srl_epi64(_mm256_mul_epu32(_mm256_srli_epi64(absolute, 32), m), count);
+    __m256i quotient = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_sign_epi32(quotient, x));
+  }
+#endif
+  for(; i < n; i++) { out[i] = divideMagic(a[i], magic, shift); }
+}
+
+static void fill(int * out, int k, std::size_t n)
+{
+  std::size_t i;
+
+  for(i = 0; i < n; i++) { out[i] = k; }
+}
+
+void CompiledExpr::evaluate_batch(const int * const * columns, std::size_t rows, int * results) const
+{
+  std::vector<int> scratch(maxDepth * BatchBlock);
+  std::vector<int> temporaries(temps * BatchBlock);
+  std::vector<const int *> operands(maxDepth);
+  std::size_t row, n;
+  const Instruction * ip;
+  int top;
+
+  for(row = 0; row < rows; row += n)
+  {
+    n = rows - row < BatchBlock ? rows - row : BatchBlock;
+    top = -1;
+
+    // operands[d] is the block of values at stack depth d: a column slice
+    // for a variable, otherwise level d of scratch.
+    for(ip = &code[0]; ip->code != EndOp; ip++)
+    {
+      // Scratch for the value this instruction leaves on top: one level up
+      // for a push, the same level for a constant op, one down for the rest.
+      int * level = &scratch[0] + (ip->code <= LoadOp ? top + 1 : top) * BatchBlock;
+      int * below = level - BatchBlock;
+
+      switch(ip->code)
+      {
+        case PushOp      : fill(level, ip->operand, n); operands[++top] = level; break;
+        case LoadOp      : operands[++top] = columns[ip->operand] + row; break;
+        case AddOp       : applyColumns<AddLanes>(operands[top - 1], operands[top], below, n); operands[--top] = below; break;
+        case SubOp       : applyColumns<SubLanes>(operands[top - 1], operands[top], below, n); operands[--top] = below; break;
+        case MulOp       : applyColumns<MulLanes>(operands[top - 1], operands[top], below, n); operands[--top] = below; break;
+        case DivOp       : applyColumns<DivLanes>(operands[top - 1], operands[top], below, n); operands[--top] = below; break;
+        case ZeroOp      : fill(below, 0, n); operands[--top] = below; break;
+        case AddConstOp  : applyConstant<AddLanes>(operands[top], ip->operand, level, n); operands[top] = level; break;
+        case SubConstOp  : applyConstant<SubLanes>(operands[top], ip->operand, level, n); operands[top] = level; break;
+        case MulConstOp  : applyConstant<MulLanes>(operands[top], ip->operand, level, n); operands[top] = level; break;
+        case DivConstOp  : applyConstant<DivLanes>(operands[top], ip->operand, level, n); operands[top] = level; break;
+        case ZeroConstOp : fill(level, 0, n); operands[top] = level; break;
+        case ShlConstOp  : applyShift(operands[top], ip->shift, level, n); operands[top] = level; break;
+        case DivMagicOp  : applyMagic(operands[top], ip->operand, ip->shift, level, n); operands[top] = level; break;
+        case TeeOp       : std::memcpy(&temporaries[ip->operand * BatchBlock], operands[top], n * sizeof(int)); break;
+        case TempOp      : operands[++top] = &temporaries[ip->operand * BatchBlock]; break;
+        default          : break;
+      }
+    }
+    std::memcpy(results + row, operands[0], n * sizeof(int));
+  }
+}
@@ -0,0 +1,144 @@
+#ifndef _EXPR_BYTECODE_H
+#define _EXPR_BYTECODE_H
+
+/*
+ * Flat bytecode for ExprTrees that are evaluated many times.
+ *
+ * CompiledExpr walks the tree once and writes it out in postfix order as an
+ * array of 8-byte instructions: "3 * (4 + 5)" becomes
+ *
+ *   Push 3, Push 4, AddConst 5, Mul, End
+ *
+ * (an operator whose right operand is a literal takes it as an immediate).
+ * evaluate() then runs a small stack machine over the array, so each
+ * evaluation is a linear scan with no pointer chasing, no recursion and
+ * no getOperator()/isOperator() calls per node. Under GCC
+ * and Clang the dispatch uses computed goto (one indirect jump per
+ * instruction), elsewhere a switch.
+ *
+ * The bytecode does not point into the tree, so the tree can be destroyed
+ * once it has been compiled.
+ *
+ * Variables are numbered 0, 1, 2... in the order they first appear in the
+ * expression ("slots"); evaluate(values) reads variable slot i from
+ * values[i]. evaluate_batch runs the expression over whole columns of
+ * inputs, one pass over a block of rows per instruction. Build with
+ * -mavx2 (or -march=native) to get 8 rows per step; otherwise the same
+ * loops are left to the compiler's auto-vectoriser.
+ *
+ * A node used more than once (from buildTree with shareSubtrees), even as
+ * both operands of one operator, is evaluated once: its value is saved in a temporary (Tee) the first time
+ * and pushed from there (Temp) every other time.
+ */
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TreeNode.h"
+
+enum OpCode : unsigned char {
+  PushOp, // Pushes operand.
+  LoadOp, // Pushes the variable in slot operand.
+  AddOp,
+  SubOp,
+  MulOp,
+  DivOp,
+  ZeroOp, // NoOp node: pops both operands, pushes 0.
+  AddConstOp, // Same as Push operand followed by the plain op.
+  SubConstOp,
+  MulConstOp,
+  DivConstOp,
+  ZeroConstOp,
+  ShlConstOp, // Multiply by 2^shift (written by reduceStrength).
+  DivMagicOp, // Divide by a constant >= 2 with a multiply (written by reduceStrength).
+  TeeOp,  // Copies the top of the stack to temporary operand.
+  TempOp, // Pushes temporary operand.
+  EndOp
+};
+
+struct Instruction {
+  OpCode code;
+  unsigned char shift; // ShlConst and DivMagic only.
+  int operand;
+};
+
+class CompiledExpr {
+
+private:
+
+  std::vector<Instruction> code;
+  int maxDepth; // Deepest the value stack gets.
+  std::vector<int> variables; // Variable id of each slot.
+  int temps; // Temporaries for shared nodes.
+
+  void emit(TreeNode * root, std::unordered_map<TreeNode *, int> & shared);
+  int slotOf(int id);
+
+  friend int reduceStrength(CompiledExpr & expr);
+
+public:
+
+  /*
+   * @desc Bytecode for the empty tree; evaluates to 0.
+   */
+  CompiledExpr();
+
+  /*
+   * @desc Compiles the tree rooted at "root" (which may be NULL).
+   */
+  explicit CompiledExpr(TreeNode * root);
+
+  /*
+   * @desc  Runs the bytecode with every variable set to 0. Gives the same
+   *        result as ExprTree::evaluate on the tree it was compiled from.
+   *        Safe to call from several threads at once.
+   */
+  int evaluate() const;
+
+  /*
+   * @desc  Runs the bytecode with variable slot i set to values[i].
+   */
+  int evaluate(const int * values) const;
+
+  /*
+   * @desc  Evaluates "rows" rows at once: variable slot i of row r is
+   *        columns[i][r], and the result goes to results[r]. Division by
+   *        zero is undefined, as it is in evaluate().
+   */
+  void evaluate_batch(const int * const * columns, std::size_t rows, int * results) const;
+
+  /*
+   * @return Number of variable slots.
+   */
+  int variable_count() const { return variables.size(); }
+
+  /*
+   * @return Slot of the variable called "name", or -1 if the expression
+   *         does not use it.
+   */
+  int variable_slot(const std::string & name) const;
+
+  /*
+   * @return Name of the variable in "slot".
+   */
+  std::string variable_name(int slot) const;
+
+  /*
+   * @return Number of instructions, including the final End.
+   */
+  std::size_t size() const { return code.size(); }
+
+  /*
+   * @return Deepest the value stack gets while evaluating.
+   */
+  int stack_depth() const { return maxDepth; }
+
+  /*
+   * @return Number of shared nodes, each evaluated once per evaluation.
+   */
+  int temporaries() const { return temps; }
+
+  const Instruction * instructions() const { return &code[0]; }
+};
+
+#endif
@@ -0,0 +1,85 @@
+/***********************
+ * CompiledExpr shared-subexpression test
+ * 1. Compiles "(a*b+1)*(a*b+1)" and "(2+3)*(2+3)" built with shared
+ *    subtrees, where one node is both operands of its parent, and checks
+ *    that the shared node gets a temporary and the results still match
+ * 2. Compiles a repeated-squaring DAG 40 levels deep (2^40 nodes as a
+ *    tree) and checks that it stays a few instructions per level
+ *
+ * Build: g++ -O2 -std=c++11 12750826ExprBytecodeTest.cpp 12750826ExprBytecode.cpp
+ *        12750826ExprTree.cpp 12750826ExprLexer.cpp 12750826ExprParser.cpp
+ *        12750826ExprVariables.cpp 12750826ExprWriter.cpp TreeNode.cpp -o bytecodetest
+ * Run:   ./bytecodetest     (exit status 0 on success)
+ * *********************
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ExprTree.h"
+#include "12750826ExprBytecode.h"
+
+/*
+ * @return True if "text" built with shared subtrees compiles to code that
+ *         uses a temporary, is no longer than, and agrees with, the code
+ *         for the plain tree.
+ */
+bool sharesSquare(const std::string & text)
+{
+  ExprTree plain = ExprTree::buildTree(ExprTree::tokenise(text));
+  ExprTree shared = ExprTree::buildTree(ExprTree::tokenise(text), true);
+  CompiledExpr tree = plain.compile();
+  CompiledExpr dag = shared.compile();
+  int values[2] = { 6, -7 };
+
+  return dag.temporaries() > 0
+      && dag.size() <= tree.size()
+      && dag.evaluate(values) == tree.evaluate(values);
+}
+
+int main()
+{
+  const int levels = 40;
+  int failures = 0;
+  int i;
+
+  if(!sharesSquare("(a*b+1)*(a*b+1)"))
+  {
+    std::cout << "FAIL: (a*b+1)*(a*b+1)" << std::endl;
+    failures++;
+  }
+  if(!sharesSquare("(2+3)*(2+3)"))
+  {
+    std::cout << "FAIL: (2+3)*(2+3)" << std::endl;
+    failures++;
+  }
+
+  // x, x*x, (x*x)*(x*x), ... starting from 3 - 4, with each level using
+  // the one below as both operands. (-1 keeps the powers within int.)
+  TreeNode three(3), four(4), start(Minus);
+  std::vector<TreeNode> squares(levels, TreeNode(Times));
+  TreeNode * top = &start;
+  int expected = -1;
+
+  start.setLeftChild(&three);
+  start.setRightChild(&four);
+  for(i = 0; i < levels; i++)
+  {
+    squares[i].setLeftChild(top);
+    squares[i].setRightChild(top);
+    top = &squares[i];
+    expected *= expected;
+  }
+
+  CompiledExpr doubling(top);
+  if(doubling.temporaries() != levels || doubling.size() > 4 * (std::size_t)levels + 4
+     || doubling.evaluate() != expected)
+  {
+    std::cout << "FAIL: repeated squaring, " << doubling.size() << " instructions, "
+              << doubling.temporaries() << " temporaries" << std::endl;
+    failures++;
+  }
+
+  std::cout << (failures == 0 ? "PASS" : "FAILED") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
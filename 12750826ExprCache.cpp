@@ -0,0 +1,81 @@
+#include "12750826ExprCache.h"
+#include <functional>
+
+CachedExpr::CachedExpr(const std::string & text)
+  : tree(ExprTree::buildTree(ExprTree::tokenise(text))), compiled(tree.getRoot())
+{
+}
+
+ExprCache::ExprCache(std::size_t capacity, std::size_t shardCount)
+  : hitCount(0), missCount(0), evictionCount(0)
+{
+  std::size_t i;
+
+  if(shardCount == 0) { shardCount = 1; }
+  shardCapacity = (capacity + shardCount - 1) / shardCount;
+  if(shardCapacity == 0) { shardCapacity = 1; }
+
+  for(i = 0; i < shardCount; i++) { shards.push_back(std::unique_ptr<Shard>(new Shard())); }
+}
+
+std::shared_ptr<const CachedExpr> ExprCache::get(const std::string & text)
+{
+  Shard & shard = *shards[std::hash<std::string>()(text) % shards.size()];
+  std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found;
+
+  {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    found = shard.index.find(text);
+    if(found != shard.index.end())
+    {
+      shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+      hitCount++;
+      return found->second->second;
+    }
+  }
+
+  missCount++;
+  std::shared_ptr<const CachedExpr> parsed = std::make_shared<const CachedExpr>(text);
+
+  std::lock_guard<std::mutex> guard(shard.lock);
+  found = shard.index.find(text);
+  if(found != shard.index.end()) // Another thread got there first.
+  {
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    return found->second->second;
+  }
+  if(shard.entries.size() >= shardCapacity)
+  {
+    shard.index.erase(shard.entries.back().first);
+    shard.entries.pop_back();
+    evictionCount++;
+  }
+  shard.entries.push_front(Entry(text, parsed));
+  shard.index[text] = shard.entries.begin();
+  return parsed;
+}
+
+void ExprCache::clear()
+{
+  std::size_t i;
+
+  for(i = 0; i < shards.size(); i++)
+  {
+    std::lock_guard<std::mutex> guard(shards[i]->lock);
+    shards[i]->index.clear();
+    shards[i]->entries.clear();
+  }
+}
+
+std::size_t ExprCache::size()
+{
+  std::size_t total = 0;
+  std::size_t i;
+
+  for(i = 0; i < shards.size(); i++)
+  {
+    std::lock_guard<std::mutex> guard(shards[i]->lock);
+    total += shards[i]->entries.size();
+  }
+  return total;
+}
@@ -0,0 +1,94 @@
+#ifndef _EXPR_CACHE_H
+#define _EXPR_CACHE_H
+
+/*
+ * Cache of parsed and compiled expressions, keyed by their text.
+ *
+ * Services that see the same formulas over and over can look them up
+ * instead of running tokenise, buildTree and compile every time:
+ *
+ *   ExprCache cache(10000);
+ *   std::shared_ptr<const CachedExpr> f = cache.get("price * qty - discount");
+ *   int result = f->compiled.evaluate(values);
+ *
+ * Entries are immutable and shared: a caller can keep using one after it
+ * has been evicted. The cache is split into shards, each a least recently
+ * used list behind its own mutex, chosen by the hash of the text, so
+ * threads looking up different formulas rarely wait for each other. A
+ * miss parses outside the lock; if two threads miss on the same text at
+ * once, both parse it and the first to finish wins.
+ *
+ * Keys are the exact text, so "1+2" and "1 + 2" are different entries.
+ */
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ExprTree.h"
+#include "12750826ExprBytecode.h"
+
+/*
+ * @desc A parsed expression and its bytecode.
+ */
+struct CachedExpr {
+  ExprTree tree;
+  CompiledExpr compiled;
+
+  explicit CachedExpr(const std::string & text);
+};
+
+class ExprCache {
+
+private:
+
+  typedef std::pair<std::string, std::shared_ptr<const CachedExpr> > Entry;
+
+  struct Shard {
+    std::mutex lock;
+    std::list<Entry> entries; // Most recently used first.
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  };
+
+  std::vector<std::unique_ptr<Shard> > shards;
+  std::size_t shardCapacity;
+
+  std::atomic<unsigned long long> hitCount;
+  std::atomic<unsigned long long> missCount;
+  std::atomic<unsigned long long> evictionCount;
+
+public:
+
+  /*
+   * @desc  Holds up to about "capacity" expressions (rounded up to a
+   *        multiple of "shardCount").
+   */
+  explicit ExprCache(std::size_t capacity, std::size_t shardCount = 16);
+
+  ExprCache(const ExprCache &) = delete;
+  ExprCache & operator=(const ExprCache &) = delete;
+
+  /*
+   * @desc  Returns the expression for "text", parsing and compiling it if
+   *        it is not cached, and evicting the least recently used entry of
+   *        its shard if that one is full.
+   */
+  std::shared_ptr<const CachedExpr> get(const std::string & text);
+
+  /*
+   * @desc Empties the cache (the counters are kept).
+   */
+  void clear();
+
+  std::size_t size();
+
+  unsigned long long hits() const { return hitCount.load(); }
+  unsigned long long misses() const { return missCount.load(); }
+  unsigned long long evictions() const { return evictionCount.load(); }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "12750826ExprIncremental.h"
+#include "12750826ExprVariables.h"
+
+IncrementalExpr::IncrementalExpr(TreeNode * root)
+{
+  // Post-order walk that gives every node a slot once its children have
+  // one. "stage" counts the children done so far. A variable is a leaf,
+  // like a literal, even though isOperator() is true for it.
+  struct Frame { TreeNode * node; int stage; int left; };
+  std::vector<Frame> frames;
+  int last = -1; // Slot of the subtree just finished.
+
+  if(root == NULL) { return; }
+
+  Frame first = { root, 0, -1 };
+  frames.push_back(first);
+  while(!frames.empty())
+  {
+    Frame & frame = frames.back();
+    bool leaf = !frame.node->isOperator() || isVariable(frame.node);
+    TreeNode * child = NULL;
+
+    if(!leaf && frame.stage < 2)
+    {
+      if(frame.stage == 0)
+      {
+        child = frame.node->getLeftChild();
+      }
+      else
+      {
+        frame.left = last;
+        child = frame.node->getRightChild();
+      }
+      frame.stage++;
+      last = -1;
+      if(child != NULL)
+      {
+        Frame next = { child, 0, -1 };
+        frames.push_back(next); // frame is invalid from here.
+      }
+      continue;
+    }
+
+    Slot slot;
+    int index = slots.size();
+    std::unordered_map<TreeNode *, int>::iterator seen = slotOf.find(frame.node);
+
+    slot.op = frame.node->getOperator();
+    slot.leaf = leaf;
+    slot.left = leaf ? -1 : frame.left;
+    slot.right = leaf ? -1 : last;
+    slot.parent = -1;
+    slot.next = -1;
+    if(seen == slotOf.end()) { slotOf[frame.node] = index; }
+    else
+    {
+      slot.next = seen->second;
+      seen->second = index;
+    }
+    if(slot.left >= 0) { slots[slot.left].parent = index; }
+    if(slot.right >= 0) { slots[slot.right].parent = index; }
+    slots.push_back(slot);
+
+    values.push_back(0);
+    if(leaf) { values[index] = isVariable(frame.node) ? 0 : frame.node->getValue(); }
+    else { values[index] = combine(index); }
+
+    last = index;
+    frames.pop_back();
+  }
+  dirty.assign(slots.size(), 0);
+}
+
+/*
+ * The value of operator slot "slot" from its operands' cached values,
+ * computed as ExprTree::evaluate does.
+ */
+int IncrementalExpr::combine(int slot) const
+{
+  int left = operandValue(slots[slot].left);
+  int right = operandValue(slots[slot].right);
+
+  switch(slots[slot].op)
+  {
+    case Plus   : return left + right;
+    case Minus  : return left - right;
+    case Times  : return left * right;
+    case Divide : return left / right;
+    default     : return 0;
+  }
+}
+
+void IncrementalExpr::markParent(int slot)
+{
+  int parent = slots[slot].parent;
+
+  if(parent >= 0 && !dirty[parent])
+  {
+    dirty[parent] = 1;
+    pending.insert(parent, parent);
+  }
+}
+
+bool IncrementalExpr::update_leaf(TreeNode * leaf, int value)
+{
+  std::unordered_map<TreeNode *, int>::iterator found = slotOf.find(leaf);
+  int slot, node, before;
+
+  if(found == slotOf.end() || !slots[found->second].leaf) { return false; }
+
+  // A leaf used once is just a walk up its path; the batch path handles
+  // leaves shared by several parents.
+  if(slots[found->second].next >= 0 || !pending.empty())
+  {
+    set_leaf(leaf, value);
+    recompute();
+    return true;
+  }
+
+  slot = found->second;
+  if(values[slot] == value) { return true; }
+  values[slot] = value;
+  for(node = slots[slot].parent; node >= 0; node = slots[node].parent)
+  {
+    before = values[node];
+    values[node] = combine(node);
+    if(values[node] == before) { break; }
+  }
+  return true;
+}
+
+bool IncrementalExpr::set_leaf(TreeNode * leaf, int value)
+{
+  std::unordered_map<TreeNode *, int>::iterator found = slotOf.find(leaf);
+  int slot;
+
+  if(found == slotOf.end() || !slots[found->second].leaf) { return false; }
+
+  for(slot = found->second; slot >= 0; slot = slots[slot].next)
+  {
+    if(values[slot] == value) { continue; }
+    values[slot] = value;
+    markParent(slot);
+  }
+  return true;
+}
+
+void IncrementalExpr::recompute()
+{
+  while(!pending.empty())
+  {
+    int slot = pending.remove_front();
+    int before = values[slot];
+
+    dirty[slot] = 0;
+    values[slot] = combine(slot);
+    if(values[slot] != before) { markParent(slot); }
+  }
+}
+
+int IncrementalExpr::value(TreeNode * node) const
+{
+  std::unordered_map<TreeNode *, int>::const_iterator found = slotOf.find(node);
+
+  return found == slotOf.end() ? 0 : values[found->second];
+}
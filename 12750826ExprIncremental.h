@@ -0,0 +1,95 @@
+#ifndef _EXPR_INCREMENTAL_H
+#define _EXPR_INCREMENTAL_H
+
+/*
+ * Re-evaluation of an expression after some of its operands change,
+ * recomputing only what depends on them.
+ *
+ *   IncrementalExpr sheet(tree.getRoot());
+ *   sheet.update_leaf(cell, 42);      // O(depth): only cell's ancestors.
+ *   int total = sheet.value();
+ *
+ *   sheet.set_leaf(a, 1);             // Many edits at once: mark them...
+ *   sheet.set_leaf(b, 2);
+ *   sheet.recompute();                // ...then recompute each affected node once.
+ *
+ * The constructor evaluates the tree once and numbers its nodes in post
+ * order, keeping the value, children and parent of every node in flat
+ * arrays (TreeNode has no room for a cached value, and in a DAG built
+ * with shareSubtrees a node's parent link names only one of its
+ * parents). A node's number is higher than its children's, so
+ * recompute() can take the marked nodes lowest number first from a
+ * PriorityQueue and knows each one's operands are already up to date.
+ * Propagation stops early at any node whose value does not change.
+ *
+ * Leaves are literal nodes and variables (which start at 0, as in
+ * ExprTree::evaluate). A node shared by several parents in a DAG is
+ * updated everywhere it is used. The tree itself is never modified and
+ * must not change while an IncrementalExpr made from it is in use.
+ */
+#include <unordered_map>
+#include <vector>
+#include "TreeNode.h"
+#include "12750826PriorityQueue.h"
+
+class IncrementalExpr {
+
+private:
+
+  struct Slot {
+    Operator op;
+    bool leaf;
+    int left;   // Children's slots, -1 if missing (counts as 0).
+    int right;
+    int parent; // -1 for the root.
+    int next;   // Next slot for the same TreeNode (DAGs only), or -1.
+  };
+
+  std::vector<Slot> slots;
+  std::vector<int> values;
+  std::vector<char> dirty; // Queued in "pending".
+  std::unordered_map<TreeNode *, int> slotOf;
+  PriorityQueue<int> pending;
+
+  int operandValue(int slot) const { return slot < 0 ? 0 : values[slot]; }
+  int combine(int slot) const;
+  void markParent(int slot);
+
+public:
+
+  /*
+   * @desc Evaluates the tree under "root" (which may be NULL) and caches
+   *       the value of every node.
+   */
+  explicit IncrementalExpr(TreeNode * root);
+
+  /*
+   * @desc   Gives "leaf" (a literal or variable node of the tree) the value
+   *         "value" and brings every value that depends on it up to date.
+   * @return False if "leaf" is not a leaf of this tree.
+   */
+  bool update_leaf(TreeNode * leaf, int value);
+
+  /*
+   * @desc   Like update_leaf, but only marks the nodes above "leaf" as
+   *         needing recomputation; call recompute() after the last edit.
+   */
+  bool set_leaf(TreeNode * leaf, int value);
+
+  /*
+   * @desc Recomputes every node marked by set_leaf, each once.
+   */
+  void recompute();
+
+  /*
+   * @return The value of the whole expression, as of the last update.
+   */
+  int value() const { return values.empty() ? 0 : values.back(); }
+
+  /*
+   * @return The cached value of "node", or 0 if it is not in the tree.
+   */
+  int value(TreeNode * node) const;
+};
+
+#endif
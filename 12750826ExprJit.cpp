@@ -0,0 +1,189 @@
+#include "12750826ExprJit.h"
+#include <utility>
+
+/*
+ * Deepest expression stack the JIT takes on: the generated code keeps it
+ * on the thread's stack (8 bytes a value), so anything deeper stays on
+ * the interpreter, which keeps its stack on the heap.
+ */
+static const int MaxJitStackDepth = 64 * 1024;
+
+#ifdef EXPR_JIT_AVAILABLE
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Appends raw instruction bytes.
+ */
+static void emitBytes(std::vector<unsigned char> & out, const char * bytes, std::size_t length)
+{
+  out.insert(out.end(), (const unsigned char *)bytes, (const unsigned char *)bytes + length);
+}
+
+/*
+ * Appends a little-endian 32-bit immediate or displacement.
+ */
+static void emitImmediate(std::vector<unsigned char> & out, int value)
+{
+  unsigned int bits = (unsigned int)value;
+  int i;
+
+  for(i = 0; i < 4; i++) { out.push_back((bits >> (8 * i)) & 0xff); }
+}
+
+/*
+ * Stack machine to x86-64, System V ABI: values arrives in rdi, the top of
+ * the stack lives in eax and everything below it is pushed on the machine
+ * stack, one 8-byte slot per value. rsi holds the entry rsp; temporaries
+ * for shared nodes sit just below it.
+ */
+void JitExpr::assemble(const CompiledExpr & expr, std::vector<unsigned char> & out)
+{
+  const Instruction * ip;
+
+  emitBytes(out, "\x48\x89\xe6", 3);           // mov rsi, rsp
+  if(expr.temporaries() > 0)
+  {
+    emitBytes(out, "\x48\x81\xec", 3);         // sub rsp, imm32
+    emitImmediate(out, (expr.temporaries() * 4 + 15) / 16 * 16);
+  }
+
+  for(ip = expr.instructions(); ip->code != EndOp; ip++)
+  {
+    switch(ip->code)
+    {
+      case PushOp :
+        emitBytes(out, "\x50\xb8", 2);         // push rax; mov eax, imm32
+        emitImmediate(out, ip->operand);
+        break;
+      case LoadOp :
+        emitBytes(out, "\x50\x8b\x87", 3);     // push rax; mov eax, [rdi + disp32]
+        emitImmediate(out, ip->operand * 4);
+        break;
+      case AddOp :
+        emitBytes(out, "\x59\x01\xc8", 3);     // pop rcx; add eax, ecx
+        break;
+      case SubOp :
+        emitBytes(out, "\x59\x29\xc1\x89\xc8", 5); // pop rcx; sub ecx, eax; mov eax, ecx
+        break;
+      case MulOp :
+        emitBytes(out, "\x59\x0f\xaf\xc1", 4); // pop rcx; imul eax, ecx
+        break;
+      case DivOp :
+        emitBytes(out, "\x89\xc1\x58\x99\xf7\xf9", 6); // mov ecx, eax; pop rax; cdq; idiv ecx
+        break;
+      case ZeroOp :
+        emitBytes(out, "\x59\x31\xc0", 3);     // pop rcx; xor eax, eax
+        break;
+      case AddConstOp :
+        emitBytes(out, "\x05", 1);             // add eax, imm32
+        emitImmediate(out, ip->operand);
+        break;
+      case SubConstOp :
+        emitBytes(out, "\x2d", 1);             // sub eax, imm32
+        emitImmediate(out, ip->operand);
+        break;
+      case MulConstOp :
+        emitBytes(out, "\x69\xc0", 2);         // imul eax, eax, imm32
+        emitImmediate(out, ip->operand);
+        break;
+      case DivConstOp :
+        emitBytes(out, "\xb9", 1);             // mov ecx, imm32
+        emitImmediate(out, ip->operand);
+        emitBytes(out, "\x99\xf7\xf9", 3);     // cdq; idiv ecx
+        break;
+      case ZeroConstOp :
+        emitBytes(out, "\x31\xc0", 2);         // xor eax, eax
+        break;
+      case ShlConstOp :
+        emitBytes(out, "\xc1\xe0", 2);         // shl eax, imm8
+        out.push_back(ip->shift);
+        break;
+      case DivMagicOp :
+        // ecx = sign mask of eax; eax = |eax| (upper half of rax cleared)
+        emitBytes(out, "\x89\xc1\xc1\xf9\x1f\x31\xc8\x29\xc8", 9);
+        emitBytes(out, "\xba", 1);             // mov edx, imm32
+        emitImmediate(out, ip->operand);
+        emitBytes(out, "\x48\x0f\xaf\xc2", 4); // imul rax, rdx
+        emitBytes(out, "\x48\xc1\xe8", 3);     // shr rax, imm8
+        out.push_back(ip->shift);
+        emitBytes(out, "\x31\xc8\x29\xc8", 4); // xor eax, ecx; sub eax, ecx (restore sign)
+        break;
+      case TeeOp :
+        emitBytes(out, "\x89\x86", 2);         // mov [rsi + disp32], eax
+        emitImmediate(out, -4 * (ip->operand + 1));
+        break;
+      case TempOp :
+        emitBytes(out, "\x50\x8b\x86", 3);     // push rax; mov eax, [rsi + disp32]
+        emitImmediate(out, -4 * (ip->operand + 1));
+        break;
+      default :
+        break;
+    }
+  }
+
+  // Drops the caller's rax (saved by the first push) and the temporaries.
+  emitBytes(out, "\x48\x89\xf4\xc3", 4);       // mov rsp, rsi; ret
+}
+
+JitExpr::JitExpr(const CompiledExpr & expr) : code(0), bytes(0)
+{
+#ifdef EXPR_JIT_AVAILABLE
+  std::vector<unsigned char> machineCode;
+  std::size_t page = sysconf(_SC_PAGESIZE);
+  void * buffer;
+
+  if(expr.stack_depth() > MaxJitStackDepth) { return; }
+  assemble(expr, machineCode);
+  bytes = (machineCode.size() + page - 1) / page * page;
+
+  buffer = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(buffer == MAP_FAILED)
+  {
+    bytes = 0;
+    return;
+  }
+  std::memcpy(buffer, &machineCode[0], machineCode.size());
+
+  // Never writable and executable at the same time.
+  if(mprotect(buffer, bytes, PROT_READ | PROT_EXEC) != 0)
+  {
+    munmap(buffer, bytes);
+    bytes = 0;
+    return;
+  }
+  code = buffer;
+  bytes = machineCode.size();
+#else
+  (void)expr;
+#endif
+}
+
+JitExpr::~JitExpr()
+{
+#ifdef EXPR_JIT_AVAILABLE
+  if(code)
+  {
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    munmap(code, (bytes + page - 1) / page * page);
+  }
+#endif
+}
+
+JitExpr::JitExpr(JitExpr && other) : code(other.code), bytes(other.bytes)
+{
+  other.code = 0;
+  other.bytes = 0;
+}
+
+JitExpr & JitExpr::operator=(JitExpr && other)
+{
+  if(this != &other)
+  {
+    std::swap(code, other.code);
+    std::swap(bytes, other.bytes);
+  }
+  return *this;
+}
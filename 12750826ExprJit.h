@@ -0,0 +1,111 @@
+#ifndef _EXPR_JIT_H
+#define _EXPR_JIT_H
+
+/*
+ * Native x86-64 code for hot expressions.
+ *
+ * JitExpr translates the bytecode of a CompiledExpr (12750826ExprBytecode.h)
+ * one instruction at a time into machine code, keeping the top of the stack
+ * in eax and the rest on the machine stack, and puts it in its own mmap'd
+ * buffer (written first, then made read+execute only). The result is called
+ * through a plain function pointer:
+ *
+ *   JitExpr jit(expr.compile());
+ *   JitFunction f = jit.function();   // NULL if the JIT is not available
+ *   int result = f(values);           // values[i] = variable slot i
+ *
+ * AdaptiveExpr interprets the bytecode and switches to the JIT after a
+ * set number of evaluations, so only formulas that are actually hot pay
+ * for code generation. On anything other than x86-64 Linux/BSD/macOS
+ * (System V calling convention) both stay on the interpreter.
+ */
+#include <cstddef>
+#include <vector>
+#include "12750826ExprBytecode.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__unix__) || defined(__APPLE__))
+#define EXPR_JIT_AVAILABLE 1
+#endif
+
+typedef int (*JitFunction)(const int * values);
+
+class JitExpr {
+
+private:
+
+  void * code;       // Executable mapping, or NULL.
+  std::size_t bytes; // Size of the mapping.
+
+  static void assemble(const CompiledExpr & expr, std::vector<unsigned char> & out);
+
+public:
+
+  JitExpr() : code(0), bytes(0) {}
+
+  /*
+   * @desc  Generates native code for "expr". function() stays NULL if the
+   *        platform is not supported, the buffer cannot be mapped or the
+   *        expression nests too deeply to run on the thread's stack.
+   */
+  explicit JitExpr(const CompiledExpr & expr);
+
+  ~JitExpr();
+
+  JitExpr(JitExpr && other);
+  JitExpr & operator=(JitExpr && other);
+  JitExpr(const JitExpr &) = delete;
+  JitExpr & operator=(const JitExpr &) = delete;
+
+  /*
+   * @return The generated function, or NULL. It is valid while this
+   *         JitExpr is alive, and gives the same results as
+   *         CompiledExpr::evaluate(values).
+   */
+  JitFunction function() const { return reinterpret_cast<JitFunction>(code); }
+
+  /*
+   * @return Bytes of machine code generated.
+   */
+  std::size_t size() const { return bytes; }
+};
+
+/*
+ * @desc  An expression that runs on the interpreter until it has been
+ *        evaluated "threshold" times, then on native code. Not safe to
+ *        share between threads; give each thread its own.
+ */
+class AdaptiveExpr {
+
+private:
+
+  CompiledExpr expr;
+  JitExpr jit;
+  JitFunction native;
+  long evaluations;
+  long threshold;
+
+public:
+
+  explicit AdaptiveExpr(const CompiledExpr & e, long jitThreshold = 1000)
+    : expr(e), native(0), evaluations(0), threshold(jitThreshold) {}
+
+  int evaluate(const int * values)
+  {
+    if(native) { return native(values); }
+    if(++evaluations == threshold)
+    {
+      jit = JitExpr(expr);
+      native = jit.function();
+    }
+    return expr.evaluate(values);
+  }
+
+  /*
+   * @return True once evaluate() runs native code.
+   */
+  bool compiled() const { return native != 0; }
+
+  const CompiledExpr & bytecode() const { return expr; }
+};
+
+#endif
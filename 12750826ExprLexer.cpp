@@ -0,0 +1,109 @@
+#include "12750826ExprLexer.h"
+#include "12750826ExprVariables.h"
+
+/*
+ * Character classes for the lexer, so the main loop is one table lookup
+ * per character instead of a chain of comparisons.
+ */
+enum CharClass : unsigned char { OtherChar, SpaceChar, DigitChar, OperatorChar, ParenChar, LetterChar };
+
+struct CharTable {
+  CharClass classes[256];
+
+  CharTable()
+  {
+    int c;
+
+    for(c = 0; c < 256; c++) { classes[c] = OtherChar; }
+    for(c = '0'; c <= '9'; c++) { classes[c] = DigitChar; }
+    for(c = 'a'; c <= 'z'; c++) { classes[c] = LetterChar; }
+    for(c = 'A'; c <= 'Z'; c++) { classes[c] = LetterChar; }
+    classes[(unsigned char)'_'] = LetterChar;
+    classes[(unsigned char)' '] = SpaceChar;
+    classes[(unsigned char)'\t'] = SpaceChar;
+    classes[(unsigned char)'\n'] = SpaceChar;
+    classes[(unsigned char)'\r'] = SpaceChar;
+    classes[(unsigned char)'\v'] = SpaceChar;
+    classes[(unsigned char)'\f'] = SpaceChar;
+    classes[(unsigned char)'+'] = OperatorChar;
+    classes[(unsigned char)'-'] = OperatorChar;
+    classes[(unsigned char)'*'] = OperatorChar;
+    classes[(unsigned char)'/'] = OperatorChar;
+    classes[(unsigned char)'('] = ParenChar;
+    classes[(unsigned char)')'] = ParenChar;
+  }
+};
+
+static const CharTable charTable;
+
+std::size_t lexExpression(const char * text, std::size_t length, std::vector<ExprToken> & tokens)
+{
+  const char * p = text;
+  const char * end = text + length;
+  std::size_t before = tokens.size();
+  ExprToken token;
+
+  while(p < end)
+  {
+    switch(charTable.classes[(unsigned char)*p])
+    {
+      case SpaceChar:
+        p++;
+        break;
+
+      case DigitChar:
+      {
+        // Parse the whole run of digits in place (wraps like atoi on overflow).
+        unsigned int value = 0;
+        while(p < end && charTable.classes[(unsigned char)*p] == DigitChar)
+        {
+          value = value * 10 + (*p - '0');
+          p++;
+        }
+        token.kind = NumberToken;
+        token.op = 0;
+        token.value = (int)value;
+        tokens.push_back(token);
+        break;
+      }
+
+      case LetterChar:
+      {
+        // A variable name: letters, digits and underscores.
+        const char * start = p;
+        while(p < end && (charTable.classes[(unsigned char)*p] == LetterChar || charTable.classes[(unsigned char)*p] == DigitChar))
+        {
+          p++;
+        }
+        token.value = variableId(start, p - start);
+        token.kind = token.value >= 0 ? VariableToken : UnknownToken; // The registry is full.
+        token.op = token.value >= 0 ? 0 : *start;
+        tokens.push_back(token);
+        break;
+      }
+
+      case OperatorChar:
+        token.kind = OperatorToken;
+        token.op = *p++;
+        token.value = 0;
+        tokens.push_back(token);
+        break;
+
+      case ParenChar:
+        token.kind = (*p == '(') ? OpenParenToken : CloseParenToken;
+        token.op = *p++;
+        token.value = 0;
+        tokens.push_back(token);
+        break;
+
+      default:
+        token.kind = UnknownToken;
+        token.op = *p++;
+        token.value = 0;
+        tokens.push_back(token);
+        break;
+    }
+  }
+
+  return tokens.size() - before;
+}
@@ -0,0 +1,40 @@
+#ifndef _EXPR_LEXER_H
+#define _EXPR_LEXER_H
+
+/*
+ * Single-pass lexer for ExprTree expressions.
+ *
+ * Instead of one std::string per token, the lexer appends small fixed-size
+ * ExprToken structs to a caller-owned vector, with integers already parsed.
+ * Spacing does not matter: "3*(4+5)", "((1+2))" and "3 * ( 4 + 5 )" all
+ * give the same tokens. Reusing the same vector across calls means no
+ * allocation at all once it has grown.
+ *
+ * Identifiers ([A-Za-z_][A-Za-z0-9_]*) are variables; the lexer interns
+ * them (12750826ExprVariables.h) and the token carries the variable id.
+ */
+#include <cstddef>
+#include <vector>
+
+enum TokenKind : unsigned char {
+  NumberToken,     // value holds the parsed integer
+  OperatorToken,   // op is '+', '-', '*' or '/'
+  OpenParenToken,  // op is '('
+  CloseParenToken, // op is ')'
+  VariableToken,   // value holds the variable id
+  UnknownToken     // op is the unexpected character
+};
+
+struct ExprToken {
+  TokenKind kind;
+  char op;
+  int value;
+};
+
+/*
+ * Breaks text[0, length) into tokens and appends them to "tokens".
+ * Returns the number of tokens appended.
+ */
+std::size_t lexExpression(const char * text, std::size_t length, std::vector<ExprToken> & tokens);
+
+#endif
@@ -0,0 +1,319 @@
+#include "12750826ExprOptimiser.h"
+#include "12750826ExprVariables.h"
+#include <climits>
+#include <utility>
+#include <vector>
+
+/*
+ * One step of a tree rewrite: builds the rewritten "op" node in "arena"
+ * over its already rewritten children and counts what it changed in
+ * "rewrites".
+ */
+typedef TreeNode * (*Rewrite)(Operator op, TreeNode * left, TreeNode * right, NodeArena & arena, int & rewrites);
+
+static bool isLiteral(TreeNode * node)
+{
+  return node != NULL && !node->isOperator();
+}
+
+static bool isLiteral(TreeNode * node, int value)
+{
+  return isLiteral(node) && node->getValue() == value;
+}
+
+/*
+ * @desc Makes an operator node over "left" and "right" (either may be NULL).
+ */
+static TreeNode * join(Operator op, TreeNode * left, TreeNode * right, NodeArena & arena)
+{
+  TreeNode * node = arena.create(op);
+
+  node->setLeftChild(left);
+  node->setRightChild(right);
+  if(left) { left->setParent(node); }
+  if(right) { right->setParent(node); }
+  return node;
+}
+
+/*
+ * @desc   a op b as evaluate() would compute it, wrapping on overflow.
+ * @return False if it would trap (division by zero or INT_MIN / -1).
+ */
+static bool apply(Operator op, int a, int b, int & result)
+{
+  switch(op)
+  {
+    case Plus   : result = (int)((unsigned int)a + (unsigned int)b); return true;
+    case Minus  : result = (int)((unsigned int)a - (unsigned int)b); return true;
+    case Times  : result = (int)((unsigned int)a * (unsigned int)b); return true;
+    case Divide :
+      if(b == 0 || (a == INT_MIN && b == -1)) { return false; }
+      result = a / b;
+      return true;
+    default     : result = 0; return true;
+  }
+}
+
+/*
+ * @return True if "a" and "b" are the same expression, node for node.
+ */
+static bool sameTree(TreeNode * a, TreeNode * b)
+{
+  // Explicit stack of node pairs still to compare, so any depth works.
+  std::vector<std::pair<TreeNode *, TreeNode *> > pending;
+
+  pending.push_back(std::make_pair(a, b));
+  while(!pending.empty())
+  {
+    a = pending.back().first;
+    b = pending.back().second;
+    pending.pop_back();
+
+    if(a == NULL || b == NULL)
+    {
+      if(a != b) { return false; }
+      continue;
+    }
+    // The value is a literal's number or a variable's id, and 0 otherwise.
+    if(a->getOperator() != b->getOperator() || a->getValue() != b->getValue()) { return false; }
+    pending.push_back(std::make_pair(a->getRightChild(), b->getRightChild()));
+    pending.push_back(std::make_pair(a->getLeftChild(), b->getLeftChild()));
+  }
+  return true;
+}
+
+/*
+ * @desc Copies the leaves that no pass rewrites: NULL, literals and variables.
+ * @return The copy, or NULL if "node" is an operator (with "handled" false).
+ */
+static TreeNode * copyLeaf(TreeNode * node, NodeArena & arena, bool & handled)
+{
+  handled = true;
+  if(node == NULL) { return NULL; }
+  if(isVariable(node)) { return createVariableNode(variableOf(node), arena); }
+  if(isLiteral(node)) { return arena.create(node->getValue()); }
+  handled = false;
+  return NULL;
+}
+
+/*
+ * @desc Copies "root" into "arena", applying "rewrite" to every operator
+ *       node once its children have been rewritten.
+ */
+static TreeNode * rewriteTree(TreeNode * root, NodeArena & arena, Rewrite rewrite, int & rewrites)
+{
+  // Post-order walk with an explicit stack, so any depth of tree works.
+  // "stage" counts the children done so far.
+  struct Frame { TreeNode * node; int stage; TreeNode * left; };
+  std::vector<Frame> frames;
+  TreeNode * last; // Rewrite of the subtree just finished.
+  bool handled;
+
+  last = copyLeaf(root, arena, handled);
+  if(handled) { return last; }
+
+  Frame first = { root, 0, NULL };
+  frames.push_back(first);
+  while(!frames.empty())
+  {
+    Frame & frame = frames.back();
+
+    if(frame.stage < 2)
+    {
+      TreeNode * child;
+
+      if(frame.stage == 0)
+      {
+        child = frame.node->getLeftChild();
+      }
+      else
+      {
+        frame.left = last;
+        child = frame.node->getRightChild();
+      }
+      frame.stage++;
+      last = copyLeaf(child, arena, handled);
+      if(!handled)
+      {
+        Frame next = { child, 0, NULL };
+        frames.push_back(next); // frame is invalid from here.
+      }
+      continue;
+    }
+
+    last = rewrite(frame.node->getOperator(), frame.left, last, arena, rewrites);
+    frames.pop_back();
+  }
+  return last;
+}
+
+static TreeNode * fold(Operator op, TreeNode * left, TreeNode * right, NodeArena & arena, int & rewrites)
+{
+  int a = isLiteral(left) ? left->getValue() : 0; // A missing child evaluates to 0.
+  int b = isLiteral(right) ? right->getValue() : 0;
+  int result;
+
+  if((left == NULL || isLiteral(left)) && (right == NULL || isLiteral(right)) && apply(op, a, b, result))
+  {
+    rewrites++;
+    return arena.create(result);
+  }
+
+  // Gather constants along a chain: (x + a) + b -> x + (a + b), likewise
+  // for - and for *.
+  if(isLiteral(right) && left != NULL && isLiteral(left->getRightChild()))
+  {
+    Operator inner = left->getOperator();
+    int c = left->getRightChild()->getValue();
+
+    if((op == Plus || op == Minus) && (inner == Plus || inner == Minus))
+    {
+      unsigned int offset = inner == Plus ? (unsigned int)c : 0u - (unsigned int)c;
+      offset = op == Plus ? offset + (unsigned int)b : offset - (unsigned int)b;
+
+      rewrites++;
+      if((int)offset < 0 && (int)offset != INT_MIN)
+      {
+        return join(Minus, left->getLeftChild(), arena.create(-(int)offset), arena);
+      }
+      return join(Plus, left->getLeftChild(), arena.create((int)offset), arena);
+    }
+    if(op == Times && inner == Times)
+    {
+      rewrites++;
+      return join(Times, left->getLeftChild(), arena.create((int)((unsigned int)c * (unsigned int)b)), arena);
+    }
+  }
+
+  return join(op, left, right, arena);
+}
+
+static TreeNode * simplify(Operator op, TreeNode * left, TreeNode * right, NodeArena & arena, int & rewrites)
+{
+  switch(op)
+  {
+    case Plus :
+      if(isLiteral(right, 0)) { rewrites++; return left; }
+      if(isLiteral(left, 0)) { rewrites++; return right; }
+      break;
+    case Minus :
+      if(isLiteral(right, 0)) { rewrites++; return left; }
+      if(left != NULL && sameTree(left, right)) { rewrites++; return arena.create(0); }
+      break;
+    case Times :
+      if(isLiteral(right, 1)) { rewrites++; return left; }
+      if(isLiteral(left, 1)) { rewrites++; return right; }
+      if(isLiteral(right, 0) || isLiteral(left, 0)) { rewrites++; return arena.create(0); }
+      break;
+    case Divide :
+      if(isLiteral(right, 1)) { rewrites++; return left; }
+      break;
+    default :
+      // An unknown operator always evaluates to 0.
+      rewrites++;
+      return arena.create(0);
+  }
+
+  return join(op, left, right, arena);
+}
+
+/*
+ * @desc Applies "rewrite" to the whole of "tree" and reports on it.
+ */
+static ExprTree runPass(ExprTree & tree, const char * name, Rewrite rewrite, OptimiserReport * report, int & rewrites)
+{
+  NodeArena arena;
+  TreeNode * root;
+
+  rewrites = 0;
+  root = rewriteTree(tree.getRoot(), arena, rewrite, rewrites);
+
+  ExprTree result(root, std::move(arena));
+  if(report)
+  {
+    PassReport entry = { name, tree.size(), result.size(), rewrites };
+    report->push_back(entry);
+  }
+  return result;
+}
+
+ExprTree foldConstants(ExprTree & tree, OptimiserReport * report)
+{
+  int rewrites;
+  return runPass(tree, "constant folding", fold, report, rewrites);
+}
+
+ExprTree simplifyAlgebra(ExprTree & tree, OptimiserReport * report)
+{
+  int rewrites;
+  return runPass(tree, "algebraic simplification", simplify, report, rewrites);
+}
+
+ExprTree optimise(ExprTree & tree, OptimiserReport * report)
+{
+  int folded, simplified;
+  ExprTree current = runPass(tree, "constant folding", fold, report, folded);
+
+  // Every rewrite removes nodes, so this stops.
+  for(;;)
+  {
+    current = runPass(current, "algebraic simplification", simplify, report, simplified);
+    if(simplified == 0) { break; }
+    current = runPass(current, "constant folding", fold, report, folded);
+    if(folded == 0) { break; }
+  }
+  return current;
+}
+
+int reduceStrength(CompiledExpr & expr)
+{
+  std::vector<Instruction>::iterator it;
+  int rewrites = 0;
+
+  for(it = expr.code.begin(); it != expr.code.end(); it++)
+  {
+    unsigned int k = (unsigned int)it->operand;
+    int log = 0;
+
+    if(it->code == MulConstOp && it->operand > 1 && (k & (k - 1)) == 0)
+    {
+      while((1u << log) < k) { log++; }
+      it->code = ShlConstOp;
+      it->shift = log;
+      rewrites++;
+    }
+    else if(it->code == DivConstOp && it->operand >= 2)
+    {
+      // Granlund-Montgomery: with l = ceil(log2 k) and
+      // magic = floor(2^(31 + l) / k) + 1 (which fits in 32 bits),
+      // n / k == (n * magic) >> (31 + l) for every 0 <= n <= 2^31.
+      while((1ull << log) < k) { log++; }
+      it->code = DivMagicOp;
+      it->shift = 31 + log;
+      it->operand = (int)(unsigned int)((1ull << (31 + log)) / k + 1);
+      rewrites++;
+    }
+  }
+  return rewrites;
+}
+
+int reduceStrength(CompiledExpr & expr, OptimiserReport * report)
+{
+  int rewrites = reduceStrength(expr);
+
+  if(report)
+  {
+    PassReport entry = { "strength reduction", (int)expr.size(), (int)expr.size(), rewrites };
+    report->push_back(entry);
+  }
+  return rewrites;
+}
+
+CompiledExpr optimiseAndCompile(ExprTree & tree, OptimiserReport * report)
+{
+  ExprTree optimised = optimise(tree, report);
+  CompiledExpr expr = optimised.compile();
+
+  reduceStrength(expr, report);
+  return expr;
+}
@@ -0,0 +1,60 @@
+#ifndef _EXPR_OPTIMISER_H
+#define _EXPR_OPTIMISER_H
+
+/*
+ * Optimisation passes for ExprTrees and their bytecode.
+ *
+ *   foldConstants    (3 * 4) -> 12, and constants gathered along chains:
+ *                    ((x + 3) + 4) -> x + 7, ((x * 2) * 5) -> x * 10.
+ *   simplifyAlgebra  Identities x + 0, 0 + x, x - 0, x * 1, 1 * x, x / 1 -> x;
+ *                    annihilators x * 0, 0 * x -> 0; x - x -> 0 for any
+ *                    two identical subtrees; unknown operators -> 0.
+ *   reduceStrength   On bytecode: multiply by 2^k becomes a shift, and
+ *                    division by a constant >= 2 a multiply and a shift.
+ *
+ * The tree passes build a new tree and leave their input alone. Every
+ * pass appends a PassReport when given one, with the node counts before
+ * and after (instruction counts for reduceStrength) and how many
+ * rewrites it made. optimise() runs the tree passes until nothing
+ * changes.
+ *
+ * The rewrites keep the results of evaluate() exactly, wrapping on
+ * overflow included. The exception is a division by zero inside a
+ * subtree that gets dropped, e.g. (1 / 0) * 0, which no longer traps.
+ * Division by zero is never folded away.
+ */
+#include <string>
+#include <vector>
+#include "ExprTree.h"
+#include "12750826ExprBytecode.h"
+
+struct PassReport {
+  std::string pass;
+  int before;
+  int after;
+  int rewrites;
+};
+
+typedef std::vector<PassReport> OptimiserReport;
+
+ExprTree foldConstants(ExprTree & tree, OptimiserReport * report = NULL);
+
+ExprTree simplifyAlgebra(ExprTree & tree, OptimiserReport * report = NULL);
+
+/*
+ * @return Number of instructions rewritten.
+ */
+int reduceStrength(CompiledExpr & expr, OptimiserReport * report);
+int reduceStrength(CompiledExpr & expr);
+
+/*
+ * @desc Runs foldConstants and simplifyAlgebra until neither changes the tree.
+ */
+ExprTree optimise(ExprTree & tree, OptimiserReport * report = NULL);
+
+/*
+ * @desc optimise(), then compile() and reduceStrength().
+ */
+CompiledExpr optimiseAndCompile(ExprTree & tree, OptimiserReport * report = NULL);
+
+#endif
@@ -0,0 +1,318 @@
+#include "12750826ExprParallel.h"
+#include "ExprTree.h"
+#include <sched.h>
+
+ForkJoinPool::ForkJoinPool(unsigned int count) : active(false), stopping(false)
+{
+  unsigned int i;
+
+  if(count == 0) { count = std::thread::hardware_concurrency(); }
+  if(count == 0) { count = 1; }
+
+  for(i = 0; i < count; i++)
+  {
+    workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    workers.back()->seed = 2 * i + 1;
+  }
+  for(i = 1; i < count; i++) { threads.push_back(std::thread(&ForkJoinPool::work, this, (int)i)); }
+}
+
+ForkJoinPool::~ForkJoinPool()
+{
+  unsigned int i;
+
+  {
+    std::lock_guard<std::mutex> guard(sleepLock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for(i = 0; i < threads.size(); i++) { threads[i].join(); }
+}
+
+/*
+ * @desc   Takes the oldest task of some other worker, trying each once
+ *         starting from a random one.
+ * @return The task, or NULL if every other deque was empty.
+ */
+ForkTask * ForkJoinPool::steal(int worker)
+{
+  Worker & self = *workers[worker];
+  int n = workers.size();
+  int start, i;
+
+  self.seed ^= self.seed << 13;
+  self.seed ^= self.seed >> 17;
+  self.seed ^= self.seed << 5;
+  start = self.seed % n;
+
+  for(i = 0; i < n; i++)
+  {
+    int victim = (start + i) % n;
+    if(victim == worker) { continue; }
+
+    Worker & other = *workers[victim];
+    std::lock_guard<std::mutex> guard(other.lock);
+    if(!other.tasks.empty())
+    {
+      ForkTask * task = other.tasks.front();
+      other.tasks.pop_front();
+      return task;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * @desc Body of the pool's threads: sleep until a run starts, then steal
+ *       until it ends.
+ */
+void ForkJoinPool::work(int worker)
+{
+  for(;;)
+  {
+    {
+      std::unique_lock<std::mutex> guard(sleepLock);
+      wake.wait(guard, [this]() { return stopping || active.load(); });
+      if(stopping) { return; }
+    }
+    while(active.load(std::memory_order_acquire))
+    {
+      ForkTask * task = steal(worker);
+      if(task != NULL)
+      {
+        task->execute(worker);
+        task->done.store(true, std::memory_order_release);
+      }
+      else
+      {
+        sched_yield();
+      }
+    }
+  }
+}
+
+void ForkJoinPool::run(ForkTask & root)
+{
+  std::lock_guard<std::mutex> guard(runLock);
+
+  if(workers.size() > 1)
+  {
+    {
+      std::lock_guard<std::mutex> sleeping(sleepLock);
+      active.store(true);
+    }
+    wake.notify_all();
+  }
+  root.execute(0);
+  root.done.store(true, std::memory_order_release);
+  // Every forked task was joined before root finished, so nothing is
+  // left for the workers to do.
+  active.store(false);
+}
+
+void ForkJoinPool::fork(int worker, ForkTask & task)
+{
+  Worker & self = *workers[worker];
+  std::lock_guard<std::mutex> guard(self.lock);
+
+  task.done.store(false, std::memory_order_relaxed);
+  self.tasks.push_back(&task);
+}
+
+void ForkJoinPool::join(int worker, ForkTask & task)
+{
+  Worker & self = *workers[worker];
+  bool mine = false;
+
+  // Tasks forked after this one have all been joined, so it is at the
+  // back of the deque unless it was stolen (and then, as thieves take
+  // from the front, the deque is empty).
+  {
+    std::lock_guard<std::mutex> guard(self.lock);
+    if(!self.tasks.empty() && self.tasks.back() == &task)
+    {
+      self.tasks.pop_back();
+      mine = true;
+    }
+  }
+  if(mine)
+  {
+    task.execute(worker);
+    task.done.store(true, std::memory_order_release);
+    return;
+  }
+
+  while(!task.done.load(std::memory_order_acquire))
+  {
+    ForkTask * other = steal(worker);
+    if(other != NULL)
+    {
+      other->execute(worker);
+      other->done.store(true, std::memory_order_release);
+    }
+    else
+    {
+      sched_yield();
+    }
+  }
+}
+
+/*
+ * @desc Evaluates one subtree, possibly on another worker.
+ */
+class ParallelExpr::Task : public ForkTask {
+
+public:
+
+  const ParallelExpr * expr;
+  ForkJoinPool * pool;
+  TreeNode * node;
+  int result;
+
+  Task(const ParallelExpr * e, ForkJoinPool * p, TreeNode * n) : expr(e), pool(p), node(n), result(0) {}
+
+  void execute(int worker) { result = expr->evaluate(node, *pool, worker); }
+};
+
+ParallelExpr::ParallelExpr(TreeNode * r, int grain) : root(r), forkCount(0)
+{
+  // Post-order walk that works out, for every node, the size of its
+  // subtree and whether there is a fork node in it; only the nodes that
+  // have one are kept. "stage" counts the operands done so far.
+  struct Frame { TreeNode * node; int stage; int leftNodes; bool leftForks; };
+  std::vector<Frame> pending;
+  int nodes = 0;
+  bool forks = false;
+
+  if(root == NULL) { return; }
+
+  Frame first = { root, 0, 0, false };
+  pending.push_back(first);
+  while(!pending.empty())
+  {
+    Frame & frame = pending.back();
+    TreeNode * child = NULL;
+
+    if(frame.stage == 0)
+    {
+      child = frame.node->getLeftChild();
+    }
+    else if(frame.stage == 1)
+    {
+      frame.leftNodes = nodes;
+      frame.leftForks = forks;
+      child = frame.node->getRightChild();
+    }
+    frame.stage++;
+
+    if(frame.stage <= 2)
+    {
+      if(child != NULL)
+      {
+        Frame next = { child, 0, 0, false };
+        pending.push_back(next); // frame is invalid from here.
+      }
+      else
+      {
+        nodes = 0;
+        forks = false;
+      }
+      continue;
+    }
+
+    // Both operands done: nodes/forks describe the right one.
+    bool fork = frame.leftNodes >= grain && nodes >= grain;
+    forks = forks || frame.leftForks || fork;
+    nodes = frame.leftNodes + nodes + 1;
+    if(forks) { splits[frame.node] = fork; }
+    if(fork) { forkCount++; }
+    pending.pop_back();
+  }
+}
+
+/*
+ * Same scheme as ExprTree::evaluate, but only over the nodes in splits:
+ * other operands are evaluated by ExprTree::evaluate as a whole, and at a
+ * fork node the left operand is forked instead of being walked.
+ */
+int ParallelExpr::evaluate(TreeNode * n, ForkJoinPool & pool, int worker) const
+{
+  struct Frame { TreeNode * node; int stage; int leftResult; Task * forked; };
+  std::vector<Frame> pending;
+  std::deque<Task> tasks; // Forked operands, innermost last.
+  std::unordered_map<TreeNode *, bool>::const_iterator split = splits.find(n);
+  int result = 0;
+
+  if(split == splits.end()) { return ExprTree::evaluate(n); }
+
+  Frame first = { n, 0, 0, NULL };
+  pending.push_back(first);
+  for(;;)
+  {
+    Frame & frame = pending.back();
+    TreeNode * child = NULL;
+
+    if(frame.stage == 0)
+    {
+      if(splits.find(frame.node)->second)
+      {
+        tasks.emplace_back(this, &pool, frame.node->getLeftChild());
+        frame.forked = &tasks.back();
+        pool.fork(worker, *frame.forked);
+        frame.stage = 2;
+        child = frame.node->getRightChild();
+      }
+      else
+      {
+        frame.stage = 1;
+        child = frame.node->getLeftChild();
+      }
+    }
+    else if(frame.stage == 1)
+    {
+      frame.leftResult = result;
+      frame.stage = 2;
+      child = frame.node->getRightChild();
+    }
+    else // Both operands are in: combine them.
+    {
+      int left = frame.leftResult;
+
+      if(frame.forked != NULL)
+      {
+        pool.join(worker, *frame.forked);
+        left = frame.forked->result;
+        tasks.pop_back();
+      }
+      switch(frame.node->getOperator())
+      {
+        case Plus   : result = left + result; break;
+        case Minus  : result = left - result; break;
+        case Times  : result = left * result; break;
+        case Divide : result = left / result; break;
+        default     : result = 0; break;
+      }
+      pending.pop_back();
+      if(pending.empty()) { return result; }
+      continue;
+    }
+
+    if(child != NULL && splits.count(child))
+    {
+      Frame next = { child, 0, 0, NULL };
+      pending.push_back(next);
+    }
+    else
+    {
+      result = ExprTree::evaluate(child);
+    }
+  }
+}
+
+int ParallelExpr::evaluate(ForkJoinPool & pool) const
+{
+  Task task(this, &pool, root);
+
+  pool.run(task);
+  return task.result;
+}
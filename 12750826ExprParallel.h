@@ -0,0 +1,151 @@
+#ifndef _EXPR_PARALLEL_H
+#define _EXPR_PARALLEL_H
+
+/*
+ * Fork-join evaluation of very large expression trees on many cores.
+ *
+ * The two operands of an operator node are independent, so a big enough
+ * tree can be split between threads:
+ *
+ *   ForkJoinPool pool;                 // One worker per hardware thread.
+ *   ParallelExpr expr(tree.getRoot()); // Finds the split points once...
+ *   int result = expr.evaluate(pool);  // ...and reuses them every time.
+ *
+ * ParallelExpr walks the tree once to size every subtree and keeps a side
+ * table of the few nodes that matter: "fork" nodes, where both operands
+ * have at least "grain" nodes, and their ancestors. Evaluation follows the
+ * table from the root; at a fork node the left operand becomes a task
+ * other workers can steal while the current worker carries on with the
+ * right one, and any subtree not in the table is handed straight to the
+ * sequential ExprTree::evaluate. A tree with no fork nodes (a long chain,
+ * or anything under 2 * grain nodes) therefore costs no more than the
+ * sequential evaluation.
+ *
+ * ForkJoinPool is a work-stealing pool: each worker has its own deque of
+ * tasks, pushes and pops its own at the back and steals the oldest (i.e.
+ * biggest) one from the front of someone else's when it runs out. A
+ * worker waiting for a stolen task helps with other tasks meanwhile. The
+ * thread calling evaluate() is worker 0; the others sleep between runs.
+ *
+ * The tree must not change while a ParallelExpr made from it is in use.
+ * Link with -pthread.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "TreeNode.h"
+
+/*
+ * @desc A unit of work for ForkJoinPool.
+ */
+class ForkTask {
+
+public:
+
+  std::atomic<bool> done;
+
+  ForkTask() : done(false) {}
+  virtual ~ForkTask() {}
+
+  /* Does the work, on worker "worker" of the pool. */
+  virtual void execute(int worker) = 0;
+};
+
+class ForkJoinPool {
+
+private:
+
+  struct Worker {
+    std::mutex lock;
+    std::deque<ForkTask *> tasks;
+    unsigned int seed; // For picking steal victims.
+  };
+
+  std::vector<std::unique_ptr<Worker> > workers;
+  std::vector<std::thread> threads;
+
+  std::mutex runLock;      // One run() at a time.
+  std::mutex sleepLock;
+  std::condition_variable wake;
+  std::atomic<bool> active; // A run is in progress.
+  bool stopping;
+
+  ForkTask * steal(int worker);
+  void work(int worker);
+
+public:
+
+  /*
+   * @desc  Starts "threads" - 1 workers (the caller of run() is the last
+   *        one); 0 means one per hardware thread.
+   */
+  explicit ForkJoinPool(unsigned int threads = 0);
+
+  ~ForkJoinPool();
+
+  ForkJoinPool(const ForkJoinPool &) = delete;
+  ForkJoinPool & operator=(const ForkJoinPool &) = delete;
+
+  /*
+   * @desc Runs "root" on the calling thread, with the pool's workers
+   *       stealing any tasks it forks, and returns once it is done.
+   */
+  void run(ForkTask & root);
+
+  /*
+   * @desc Makes "task" available to other workers. Only for use by a
+   *       task running on worker "worker"; it must join() it later.
+   */
+  void fork(int worker, ForkTask & task);
+
+  /*
+   * @desc Waits until "task" (forked by "worker") is done, running it
+   *       here if nobody has stolen it and helping with others if they have.
+   */
+  void join(int worker, ForkTask & task);
+
+  int size() const { return workers.size(); }
+};
+
+class ParallelExpr {
+
+private:
+
+  /*
+   * @desc Nodes on the way to a fork node, mapped to whether they are one.
+   */
+  std::unordered_map<TreeNode *, bool> splits;
+  TreeNode * root;
+  int forkCount;
+
+  class Task;
+
+  int evaluate(TreeNode * node, ForkJoinPool & pool, int worker) const;
+
+public:
+
+  static const int DefaultGrain = 16384;
+
+  /*
+   * @desc  Prepares to evaluate the tree under "root", forking wherever
+   *        both operands have at least "grain" nodes.
+   */
+  explicit ParallelExpr(TreeNode * root, int grain = DefaultGrain);
+
+  /*
+   * @desc   Gives the same result as ExprTree::evaluate(root).
+   */
+  int evaluate(ForkJoinPool & pool) const;
+
+  /*
+   * @return Number of places the evaluation can split.
+   */
+  int forks() const { return forkCount; }
+};
+
+#endif
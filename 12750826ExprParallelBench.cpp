@@ -0,0 +1,108 @@
+/***********************
+ * Fork-join evaluation benchmark
+ * 1. Builds a random balanced expression of 2^depth leaves, and a random
+ *    unbalanced one (each operand of a node gets between 1/10 and 9/10 of
+ *    its leaves) of the same size
+ * 2. Times ExprTree::evaluate, then ParallelExpr::evaluate with 1, 2, 4, ...
+ *    threads up to the number of hardware threads
+ * 3. Reports ms per evaluation and the speedup over ExprTree::evaluate
+ *
+ * Build: g++ -O2 -std=c++11 -pthread 12750826ExprParallelBench.cpp 12750826ExprParallel.cpp
+ *        12750826ExprTree.cpp 12750826ExprLexer.cpp 12750826ExprParser.cpp
+ *        12750826ExprVariables.cpp 12750826ExprWriter.cpp 12750826ExprBytecode.cpp
+ *        TreeNode.cpp -o parbench
+ * Run:   ./parbench [depth] [grain]     (defaults: 22, ParallelExpr::DefaultGrain)
+ * *********************
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include "ExprTree.h"
+#include "12750826ExprParallel.h"
+
+/*
+ * Appends an expression with "leaves" single-digit operands to "out",
+ * splitting them evenly, or unevenly if "skewed".
+ */
+void randomExpression(std::string & out, int leaves, bool skewed, std::mt19937 & rng)
+{
+  std::uniform_int_distribution<int> digit(1, 9);
+  std::uniform_int_distribution<int> tenths(1, 9);
+  int left;
+
+  if(leaves == 1)
+  {
+    out += (char)('0' + digit(rng));
+    return;
+  }
+
+  left = skewed ? std::max(1, leaves * tenths(rng) / 10) : leaves / 2;
+  out += '(';
+  randomExpression(out, left, skewed, rng);
+  out += rng() % 2 ? '+' : '-'; // No * or /, so results stay in range.
+  randomExpression(out, leaves - left, skewed, rng);
+  out += ')';
+}
+
+double timeIt(int & result, int runs, ExprTree & tree, ParallelExpr * parallel, ForkJoinPool * pool)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  int i;
+
+  for(i = 0; i < runs; i++)
+  {
+    result = parallel ? parallel->evaluate(*pool) : tree.evaluateWholeTree();
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::milli>(end - start).count() / runs;
+}
+
+void benchmark(const char * name, int depth, int grain, bool skewed)
+{
+  std::mt19937 rng(12750826);
+  std::string text;
+  unsigned int hardware = std::thread::hardware_concurrency();
+  unsigned int threads;
+  int runs = 5;
+  int expected, result;
+
+  randomExpression(text, 1 << depth, skewed, rng);
+  ExprTree tree = ExprTree::buildTree(ExprTree::tokenise(text));
+  text.clear();
+
+  ParallelExpr parallel(tree.getRoot(), grain);
+  double sequential = timeIt(expected, runs, tree, NULL, NULL);
+
+  std::cout << name << ": " << tree.size() << " nodes, " << parallel.forks() << " forks" << std::endl;
+  std::cout << "threads\tms/eval\tspeedup" << std::endl;
+  std::cout << "seq\t" << sequential << "\t1" << std::endl;
+  for(threads = 1; ; threads *= 2)
+  {
+    if(threads > hardware) { threads = hardware; }
+
+    ForkJoinPool pool(threads);
+    double ms = timeIt(result, runs, tree, &parallel, &pool);
+
+    std::cout << threads << "\t" << ms << "\t" << sequential / ms
+              << (result == expected ? "" : "\tWRONG RESULT") << std::endl;
+    if(threads >= hardware) { break; }
+  }
+  std::cout << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+  int depth = argc > 1 ? atoi(argv[1]) : 22;
+  int grain = argc > 2 ? atoi(argv[2]) : ParallelExpr::DefaultGrain;
+
+  benchmark("balanced", depth, grain, false);
+  benchmark("skewed", depth, grain, true);
+
+  return 0;
+}
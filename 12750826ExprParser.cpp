@@ -0,0 +1,216 @@
+#include "12750826ExprParser.h"
+#include "12750826ExprVariables.h"
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Precedence and node type of every operator character. Anything else is
+ * an unknown operator: lowest precedence and a NoOp node.
+ */
+struct OperatorTable {
+  int precedence[256];
+  Operator type[256];
+
+  OperatorTable()
+  {
+    int c;
+
+    for(c = 0; c < 256; c++)
+    {
+      precedence[c] = 0;
+      type[c] = NoOp;
+    }
+    precedence[(unsigned char)'+'] = 1;
+    precedence[(unsigned char)'-'] = 1;
+    precedence[(unsigned char)'*'] = 2; // Higher priority for * and /.
+    precedence[(unsigned char)'/'] = 2;
+    type[(unsigned char)'+'] = Plus;
+    type[(unsigned char)'-'] = Minus;
+    type[(unsigned char)'*'] = Times;
+    type[(unsigned char)'/'] = Divide;
+  }
+};
+
+static const OperatorTable operatorTable;
+
+/*
+ * Makes the parser's nodes in an arena. When sharing, a node that would
+ * be identical to one made before (same operator or value, same children)
+ * is that node instead; children are made first, so whole subtrees match.
+ */
+class NodeBuilder {
+
+private:
+
+  struct Key {
+    int op;
+    int value;
+    TreeNode * left;
+    TreeNode * right;
+
+    bool operator==(const Key & other) const
+    {
+      return op == other.op && value == other.value && left == other.left && right == other.right;
+    }
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key & key) const
+    {
+      std::size_t h = (std::size_t)key.op * 0x9e3779b97f4a7c15ull ^ (std::size_t)(unsigned int)key.value;
+      h = h * 0x100000001b3ull ^ (std::size_t)key.left;
+      return h * 0x100000001b3ull ^ (std::size_t)key.right;
+    }
+  };
+
+  NodeArena & arena;
+  bool share;
+  std::unordered_map<Key, TreeNode *, KeyHash> made;
+
+  TreeNode * find(const Key & key)
+  {
+    std::unordered_map<Key, TreeNode *, KeyHash>::iterator it = made.find(key);
+    return it == made.end() ? NULL : it->second;
+  }
+
+public:
+
+  NodeBuilder(NodeArena & a, bool shareSubtrees) : arena(a), share(shareSubtrees) {}
+
+  TreeNode * value(int v)
+  {
+    Key key = { -1, v, NULL, NULL }; // No operator: a literal.
+    TreeNode * node = share ? find(key) : NULL;
+
+    if(node) { return node; }
+    node = arena.create(v);
+    if(share) { made[key] = node; }
+    return node;
+  }
+
+  TreeNode * variable(int id)
+  {
+    Key key = { Variable, id, NULL, NULL };
+    TreeNode * node = share ? find(key) : NULL;
+
+    if(node) { return node; }
+    node = createVariableNode(id, arena);
+    if(share) { made[key] = node; }
+    return node;
+  }
+
+  /*
+   * @desc  An operator node over "left" and "right" (either may be NULL).
+   *        A shared child's getParent() is whichever parent used it last.
+   */
+  TreeNode * op(Operator type, TreeNode * left, TreeNode * right)
+  {
+    Key key = { type, 0, left, right };
+    TreeNode * node = share ? find(key) : NULL;
+
+    if(node) { return node; }
+    node = arena.create(type);
+    node->setLeftChild(left);
+    node->setRightChild(right);
+    if(left) { left->setParent(node); }
+    if(right) { right->setParent(node); }
+    if(share) { made[key] = node; }
+    return node;
+  }
+};
+
+/*
+ * Operator stack entry for an open parenthesis.
+ */
+static const int OpenParen = -1;
+
+/*
+ * Pops the top operator and its two operands, and pushes the node
+ * combining them.
+ */
+static void reduce(std::vector<int> & operators, std::vector<TreeNode *> & operands, NodeBuilder & nodes)
+{
+  unsigned char op = (unsigned char)operators.back();
+  TreeNode * right = operands.back();
+  operands.pop_back();
+  TreeNode * left = operands.back();
+
+  operators.pop_back();
+  operands.back() = nodes.op(operatorTable.type[op], left, right);
+}
+
+/*
+ * Shunting-yard: operands and pending operators are kept on explicit
+ * stacks, and an operator is applied (reduced) as soon as one of lower
+ * precedence, or equal precedence since all are left associative, comes
+ * after it. Nothing recurses, so nesting depth is only limited by memory.
+ */
+TreeNode * parseTokens(const ExprToken * begin, const ExprToken * end, NodeArena & arena, ParseStacks & stacks, bool shareSubtrees)
+{
+  NodeBuilder nodes(arena, shareSubtrees);
+  std::vector<TreeNode *> & operands = stacks.operands;
+  std::vector<int> & operators = stacks.operators;
+  const ExprToken * cursor;
+  bool expectOperand = true;
+  bool done = false;
+
+  if(begin == end) { return NULL; }
+  operands.clear();
+  operators.clear();
+
+  for(cursor = begin; cursor < end && !done; cursor++)
+  {
+    switch(cursor->kind)
+    {
+      case NumberToken :
+      case VariableToken :
+      case OpenParenToken :
+        // Anything after a complete expression ends it ("2 3" is 2).
+        if(!expectOperand) { done = true; break; }
+        if(cursor->kind == OpenParenToken) { operators.push_back(OpenParen); break; }
+        operands.push_back(cursor->kind == NumberToken ? nodes.value(cursor->value) : nodes.variable(cursor->value));
+        expectOperand = false;
+        break;
+
+      case CloseParenToken :
+        if(expectOperand) // Missing operand, as in "(1 +)".
+        {
+          operands.push_back(nodes.op(NoOp, NULL, NULL));
+          expectOperand = false;
+        }
+        while(!operators.empty() && operators.back() != OpenParen) { reduce(operators, operands, nodes); }
+        if(operators.empty()) { done = true; break; } // Unmatched ")" ends the expression.
+        operators.pop_back();
+        break;
+
+      default : // Operators, known or not.
+      {
+        int precedence = operatorTable.precedence[(unsigned char)cursor->op];
+
+        if(expectOperand) { operands.push_back(nodes.op(NoOp, NULL, NULL)); } // Missing operand.
+        while(!operators.empty() && operators.back() != OpenParen
+              && operatorTable.precedence[operators.back()] >= precedence)
+        {
+          reduce(operators, operands, nodes);
+        }
+        operators.push_back((unsigned char)cursor->op);
+        expectOperand = true;
+        break;
+      }
+    }
+  }
+
+  if(expectOperand) { operands.push_back(nodes.op(NoOp, NULL, NULL)); }
+  while(!operators.empty())
+  {
+    if(operators.back() == OpenParen) { operators.pop_back(); } // Unclosed "(".
+    else { reduce(operators, operands, nodes); }
+  }
+  return operands.back();
+}
+
+TreeNode * parseTokens(const ExprToken * begin, const ExprToken * end, NodeArena & arena, bool shareSubtrees)
+{
+  ParseStacks stacks;
+  return parseTokens(begin, end, arena, stacks, shareSubtrees);
+}
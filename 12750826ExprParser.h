@@ -0,0 +1,40 @@
+#ifndef _EXPR_PARSER_H
+#define _EXPR_PARSER_H
+
+/*
+ * Operator-precedence parser that builds TreeNodes straight from the
+ * ExprTokens produced by lexExpression (12750826ExprLexer.h), with no
+ * intermediate postfix list, no string comparisons and no recursion.
+ */
+#include <vector>
+#include "ExprTree.h"
+#include "12750826ExprLexer.h"
+#include "12750826NodeArena.h"
+
+/*
+ * Builds the tree for the tokens in [begin, end) and returns its root
+ * (NULL if there are no tokens). Operators are left associative, with
+ * '*' and '/' binding tighter than '+' and '-'. A missing operand becomes
+ * a NoOp node, like an unknown operator does in createOperatorNode.
+ * Every node is created in "arena".
+ *
+ * With shareSubtrees, structurally identical subtrees are built once and
+ * shared (hash-consing), so the result is a DAG: "(a*b+1) * (a*b+1)" has
+ * one node for each distinct subexpression. CompiledExpr evaluates a
+ * shared node once per evaluation.
+ */
+TreeNode * parseTokens(const ExprToken * begin, const ExprToken * end, NodeArena & arena, bool shareSubtrees = false);
+
+/*
+ * The parser's working stacks. Callers that parse many expressions can
+ * keep one and pass it to parseTokens, so that its capacity is reused
+ * instead of allocated again for every expression.
+ */
+struct ParseStacks {
+  std::vector<TreeNode *> operands;
+  std::vector<int> operators; // Operator characters and OpenParen markers.
+};
+
+TreeNode * parseTokens(const ExprToken * begin, const ExprToken * end, NodeArena & arena, ParseStacks & stacks, bool shareSubtrees = false);
+
+#endif
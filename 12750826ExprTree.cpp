@@ -1,33 +1,33 @@
 #include "ExprTree.h"
-#include <sstream>
+#include "12750826ExprLexer.h"
+#include "12750826ExprParser.h"
+#include "12750826ExprVariables.h"
+#include "12750826ExprWriter.h"
+#include <cctype>
+#include <climits>
 #include <iostream>
 
 /*
  * Helper function that tests whether a string is a non-negative integer.
  */
 
-// Recursion used for _size to construct the ExprTree(TreeNode *r)
+// Used for _size to construct the ExprTree(TreeNode *r). Walks the tree
+// with an explicit stack rather than recursion, so any depth works.
 int size(TreeNode * node)
 {
+  vector<TreeNode *> pending;
   int size = 0;
-  if(node == NULL)
-  {
-    return 0;
-  }else
+
+  if(node != NULL) { pending.push_back(node); }
+  while(!pending.empty())
   {
-    size += 1 + ::size(node->getRightChild()) + ::size(node->getLeftChild()); // +1 because of root
-    return size;
+    node = pending.back();
+    pending.pop_back();
+    size++;
+    if(node->getRightChild() != NULL) { pending.push_back(node->getRightChild()); }
+    if(node->getLeftChild() != NULL) { pending.push_back(node->getLeftChild()); }
   }
-}
-
-int getOpPriority(string op)
-{
-	//Higher priority for / and *.
-	if (op == "/") return 2;
-	else if (op == "*") return 2;
-	else if (op == "+") return 1;
-	else if (op == "-") return 1;
-	else return 0;
+  return size;
 }
 
 bool isdigit(const char & c){
@@ -56,6 +56,17 @@ bool is_number(const std::string & s)
     return !s.empty() && it == s.end();
 }
 
+/*
+ * Helper function that tests whether a string is a variable name.
+ */
+bool is_identifier(const std::string & s)
+{
+    std::string::const_iterator it = s.begin();
+    if (s.empty() || isdigit(s[0])) return false;
+    while (it != s.end() && (isalnum((unsigned char)*it) || *it == '_')) ++it;
+    return it == s.end();
+}
+
 /*
  * Helper function that converts a string to an int.
  */
@@ -67,9 +78,8 @@ int to_number(const std::string & s){
  * Helper function that converts a number to a string.
  */
 string to_string(const int & n){
-  std::stringstream stream;
-  stream << n;
-  return stream.str();
+  char digits[11];
+  return string(digits, formatInt(n, digits));
 }
 
 /*
@@ -97,6 +107,8 @@ ExprTree::ExprTree(){
 
 /*
  * Constructor that takes a TreeNode and sets up an ExprTree with that node at the root.
+ * The tree does not take ownership of the nodes (prefixOrder etc. use this to look
+ * at subtrees of another tree).
  */
 ExprTree::ExprTree(TreeNode * r){
   root = r;
@@ -104,20 +116,43 @@ ExprTree::ExprTree(TreeNode * r){
 }
 
 /*
- * Destructor to clean up the tree.
- * Not sure how to do this so not going to touch it
+ * Constructor for a tree whose nodes all came from "nodes"; the tree takes
+ * over the arena and frees every node with it.
  */
-ExprTree::~ExprTree()
+ExprTree::ExprTree(TreeNode * r, NodeArena && nodes) : arena(std::move(nodes)){
+  root = r;
+  _size = ::size(root);
+}
+
+/*
+ * Move constructor: takes over the root and the arena, no nodes are copied.
+ */
+ExprTree::ExprTree(ExprTree && other) : arena(std::move(other.arena)){
+  root = other.root;
+  _size = other._size;
+  other.root = 0;
+  other._size = 0;
+}
+
+ExprTree & ExprTree::operator=(ExprTree && other)
 {
-  TreeNode *n;
-  while(n != NULL)
+  if(this != &other)
   {
-    if(n->getRightChild != NULL)
-    {
-      delete n->getRightChild();
-    }
+    arena = std::move(other.arena);
+    root = other.root;
+    _size = other._size;
+    other.root = 0;
+    other._size = 0;
   }
+  return *this;
+}
 
+/*
+ * Destructor to clean up the tree. Nodes built by buildTree live in the
+ * tree's arena, which releases them all at once when it is destroyed.
+ */
+ExprTree::~ExprTree()
+{
 }
 
 /*
@@ -127,49 +162,34 @@ ExprTree::~ExprTree()
 
  * Reads in a string, then breaks it up into the individual components like
  * in the example above. Returns the components grouped together as a vector
- * of strings. The input string may or may not separate the components with white space. */
+ * of strings. The input string may or may not separate the components with white space.
+ * The scanning itself is done by lexExpression (12750826ExprLexer.h); callers that
+ * can use ExprTokens directly should, as it avoids a std::string per token.
+ */
 vector<string> ExprTree::tokenise(string expression)
 {
-  string field;
- 	vector<string> tokens;
- 	int posOpen;
- 	int posClose;
-  int posSpace;
-  std::istringstream iss(expression);
-
-  // std::cout << "\nStart tokenise" << std::endl;
-  //getline(iss, field, ' ')
- 	while (iss >> field) // iss automatically removes spaces
- 	{
- 		//Check if field contains '(' or ')' characters.
- 		posOpen = field.find('(');
- 		posClose = field.find(')');
-
-    // If '(' != -1 (npos = non position)
- 		if (posOpen != string::npos) //A '(' exists.
- 		{
- 		// 	std::cout << "\n(" << std::endl;
- 		// 	std::cout << field.substr(posOpen + 1, string::npos) << std::endl;
- 			tokens.push_back("(");
- 			tokens.push_back(field.substr(posOpen + 1, string::npos));
-      // substr(position, length of input)
-      // So posOpen + 1 = next set of numbers and making sure that length is not -1 (npos)
-      // This way we're not setting any length of the return substr
- 		}
- 		else if(posClose != string::npos)	//A ')' exists.
- 		{
- 		// 	std::cout << field.substr(0, posClose) << std::endl;
- 		// 	std::cout << ")" << std::endl;
- 			tokens.push_back(field.substr(0, posClose)); // posClose determines the length of the number reaching the end.
- 			tokens.push_back(")");
- 		}
- 		else // Must be an operator
- 		{
-      tokens.push_back(field);
- 			// std::cout << "[" << field << "]\n"<< std::endl;
-      // std::cout << "End of tokenise\n\n";
- 		}
-   }
+  vector<ExprToken> lexed;
+  vector<string> tokens;
+  std::size_t i;
+
+  lexExpression(expression.data(), expression.size(), lexed);
+  tokens.reserve(lexed.size());
+
+  for (i = 0; i < lexed.size(); i++)
+  {
+    if (lexed[i].kind == NumberToken)
+    {
+      tokens.push_back(::to_string(lexed[i].value));
+    }
+    else if (lexed[i].kind == VariableToken)
+    {
+      tokens.push_back(variableName(lexed[i].value));
+    }
+    else // Operators, parentheses and anything unexpected are one character each.
+    {
+      tokens.push_back(string(1, lexed[i].op));
+    }
+  }
 
   return tokens;
 }
@@ -177,167 +197,160 @@ vector<string> ExprTree::tokenise(string expression)
 /*
  * This function takes a vector of strings representing an expression (as produced
  * by tokenise(string), and builds an ExprTree representing the same expression.
+ * Each string is mapped to an ExprToken and the tree is built in one pass by
+ * parseTokens (12750826ExprParser.h). With shareSubtrees, repeated
+ * subexpressions are built once and shared, and the "tree" is a DAG.
  */
-ExprTree ExprTree::buildTree(vector<string> tokens)
+ExprTree ExprTree::buildTree(vector<string> tokens, bool shareSubtrees)
 {
-  	int i;
-  	vector<string> postFixOp;
-  	stack<string> strStack;
-  	stack<TreeNode *> treeStack;
-  	TreeNode *node, *leftNode, *rightNode;
-
-  	// std::cout << "Tokens ";
-  	// for (i = 0; i < tokens.size(); i++)
-  	// {
-  	// 	std::cout << "[" << tokens[i]<< "]\n";
-  	// }
-
-    // Convert infix vector to a postFixOp vector
-  	for (i = 0; i < tokens.size(); i++)
-  	{
-  		//For all operands, add it to our postFixOp vector.
-  		if (is_number(tokens[i]))
-  		{
-  			postFixOp.push_back(tokens[i]);
-  		}
-  		else if(tokens[i] == "(")
-  		{
-  			//Open bracket gets pushed onto stack.
-  			strStack.push(tokens[i]); // strStack stack
-  		}
-  		else if(tokens[i] == ")") //If there's an open bracket, there's a closing.
-  		{
-  			//Once we get closing bracket, start taking it
-  			//out of the stack we built when we got open bracket.
-  			while (!strStack.empty())
-  			{
-  				if (strStack.top() == "(")
-  				{
-  					strStack.pop();
-  					break;
-  				}
-  				postFixOp.push_back(strStack.top());
-  				strStack.pop();
-  			}
-  		}
-  		else
-  		{
-  			//We must have an operator type.
-  			//In this case, if stack is already empty
-  			{
-  				//Take out operators from the stack and
-  				//push to the postFixOp vector until we see
-  				//operators with lower priority than current.
-  				while (!strStack.empty() &&
-  						strStack.top() != "("  && // Otherwise there's a mismatch
-  						getOpPriority(tokens[i]) <= getOpPriority(strStack.top()))
-              // Checking precedence - '*' and '/' has higher priority
-  				{
-  					postFixOp.push_back(strStack.top());
-  				  strStack.pop();
-  				}
-  				strStack.push(tokens[i]);
-  			}
-  		}
-  	}
-
-  	//Any remaining operators on the stack built so far
-  	//needs to be popped and pushed to postFixOp vector.
-  	while (!strStack.empty())
-  	{
-  		postFixOp.push_back(strStack.top());
-  		strStack.pop();
-  	}
-  	//std::cout << "Start ";
-  	//for (i = 0; i < postFixOp.size(); i++)
-  	//{
-  	//	std::cout << "[" << postFixOp[i]<< "]";
-  	//}
-  	//std::cout << std::endl;
-
-    // Now that everything is on a vector string (postFixOp),
-    // now build the expression tree.
-  	for (i = 0; i < postFixOp.size(); i++)
-  	{
-  		//Operands are pushed onto the stack first
-  		if (is_number(postFixOp[i]))
-  		{
-  			node = new TreeNode(to_number(postFixOp[i]));
-  			treeStack.push(node);
-  		}
-  		else
-  		{
-  			// For operators use createOperatorNode()
-  			// 5 2 [-]
-  			node = createOperatorNode(postFixOp[i]);
-
-  			rightNode = treeStack.top();	//Save the right node.
-  			treeStack.pop();
-  			leftNode = treeStack.top();	//Save the left node.
-  			treeStack.pop();
-
-  			//Setup the children from this node.
-  			node->setRightChild(rightNode);
-  			node->setLeftChild(leftNode);
-
-  			//Setup the node as common parent.
-  			rightNode->setParent(node);
-  			leftNode->setParent(node);
-
-  			//Add the operator node into stack.
-  			treeStack.push(node);
-  		}
-  	}
-
-  	//Top of stack has the root.
-  	ExprTree et(treeStack.top());
-  	treeStack.pop();
-
-  	// std::cout << "infix: " << infixOrder(et.root) << std::endl;
-
-  	return et;
+  vector<ExprToken> lexed(tokens.size());
+  std::size_t i;
+
+  for (i = 0; i < tokens.size(); i++)
+  {
+    if (is_number(tokens[i]))
+    {
+      lexed[i].kind = NumberToken;
+      lexed[i].value = to_number(tokens[i]);
+    }
+    else if (is_identifier(tokens[i]) && (lexed[i].value = variableId(tokens[i])) >= 0)
+    {
+      lexed[i].kind = VariableToken;
+      lexed[i].op = 0;
+    }
+    else
+    {
+      // "(" , ")" and the operators are single characters; anything else
+      // falls through to the parser as an unknown operator (a NoOp node).
+      lexed[i].op = tokens[i].size() == 1 ? tokens[i][0] : 0;
+      lexed[i].value = 0;
+      switch (lexed[i].op)
+      {
+        case '(' : lexed[i].kind = OpenParenToken; break;
+        case ')' : lexed[i].kind = CloseParenToken; break;
+        case '+' :
+        case '-' :
+        case '*' :
+        case '/' : lexed[i].kind = OperatorToken; break;
+        default  : lexed[i].kind = UnknownToken; break;
+      }
+    }
+  }
+
+  if (lexed.empty()) { return ExprTree(); }
+
+  NodeArena nodes;
+  TreeNode * root = parseTokens(&lexed[0], &lexed[0] + lexed.size(), nodes, shareSubtrees);
+  return ExprTree(root, std::move(nodes));
 }
 
 /*
- * This function takes a TreeNode and does the maths to calculate
- * the value of the expression it represents.
+ * Evaluates the tree under "n" into "value". With Checked, a division by
+ * zero or INT_MIN / -1 stops it and returns false instead of trapping.
  */
-int ExprTree::evaluate(TreeNode * n)
+template <bool Checked>
+static bool evaluateNode(TreeNode * n, int & value)
 {
   // 1. If operator is plus, minus, times or divide then return the operator
   // 2. Depending on 1. (operator value) return that value
-  // 3. result += recurse the left and rightChild
+  // 3. result = the left and rightChild results, combined by the operator
   // 4. Base case to check if operator is a value
-  ExprTree t;
-  char op = n->getOperator();
-  int isOp = n->isOperator();
-  int leftResult = 0;
-  int rightResult = 0;
-  int totalResult = 0;
-
-  if(n == NULL) { return 0; }
-
-  while(n != NULL)
+  // Uses explicit stacks instead of recursion, so any depth of tree works.
+  // For repeated evaluation of the same tree, compile() it instead.
+  // Only operator nodes go on the stack; literal (and missing) operands
+  // are read straight from the node. "stage" says which operand a node is
+  // waiting for, and "result" carries a finished node's value back to
+  // its parent.
+  struct Frame { TreeNode * node; int stage; int leftResult; };
+  Frame local[64];
+  vector<Frame> spill;
+  Frame * pending = local;
+  int capacity = 64;
+  int top = 0;
+  int result = 0;
+  TreeNode * child;
+
+  value = 0;
+  if(n == NULL) { return true; }
+  if(!n->isOperator()) { value = n->getValue(); return true; }
+
+  pending[0].node = n;
+  pending[0].stage = 0;
+  for(;;)
   {
-    if(!isOp)
+    Frame * frame = &pending[top];
+    child = NULL;
+
+    if(frame->stage == 0) // Left operand.
     {
-      return n->getValue();
+      frame->stage = 1;
+      child = frame->node->getLeftChild();
+      if(child == NULL || !child->isOperator()) { result = child == NULL ? 0 : child->getValue(); }
+    }
+    else if(frame->stage == 1) // Right operand; result holds the left one.
+    {
+      frame->leftResult = result;
+      frame->stage = 2;
+      child = frame->node->getRightChild();
+      if(child == NULL || !child->isOperator()) { result = child == NULL ? 0 : child->getValue(); }
     }
 
-    leftResult += evaluate(n->getLeftChild());
-    rightResult += evaluate(n->getRightChild());
+    if(child != NULL && child->isOperator())
+    {
+      if(top + 1 == capacity)
+      {
+        vector<Frame> bigger(capacity * 2);
+        std::copy(pending, pending + capacity, bigger.begin());
+        spill.swap(bigger);
+        pending = &spill[0];
+        capacity *= 2;
+      }
+      top++;
+      pending[top].node = child;
+      pending[top].stage = 0;
+      continue;
+    }
+    if(frame->stage == 1) { continue; } // Go on to the right operand.
 
-    switch(op)
+    switch(frame->node->getOperator())
+    {
+      case Plus   : result = frame->leftResult + result; break;
+      case Minus  : result = frame->leftResult - result; break;
+      case Times  : result = frame->leftResult * result; break;
+      case Divide :
+        if(Checked && (result == 0 || (frame->leftResult == INT_MIN && result == -1))) { return false; }
+        result = frame->leftResult / result;
+        break;
+      default     : result = 0; break;
+    }
+    if(top == 0)
     {
-      case Plus   : return leftResult + rightResult;
-      case Minus  : return leftResult - rightResult;
-      case Times  : return leftResult * rightResult;
-      case Divide : return leftResult / rightResult;
-      default     : return 0;
+      value = result;
+      return true;
     }
+    top--;
   }
+}
 
-  return totalResult;
+/*
+ * This function takes a TreeNode and does the maths to calculate
+ * the value of the expression it represents. Variables count as 0.
+ */
+int ExprTree::evaluate(TreeNode * n)
+{
+  int value;
+
+  evaluateNode<false>(n, value);
+  return value;
+}
+
+/*
+ * Like evaluate(n), but reports a division by zero or INT_MIN / -1 by
+ * returning false, where evaluate(n) would trap.
+ */
+bool ExprTree::evaluate(TreeNode * n, int & value)
+{
+  return evaluateNode<true>(n, value);
 }
 
 /*
@@ -349,29 +362,28 @@ int ExprTree::evaluateWholeTree()
   return evaluate(root);
 }
 
+/*
+ * Flattens the tree into bytecode (12750826ExprBytecode.h) that gives the
+ * same result as evaluateWholeTree(), much faster, for as long as it is kept.
+ */
+CompiledExpr ExprTree::compile()
+{
+  return CompiledExpr(root);
+}
+
 /*
  * Given an ExprTree t, this function returns a string
  * that represents that same expression as the tree in
  * prefix notation.
+ * The traversals are done by ExprWriter (12750826ExprWriter.h), which can
+ * also write straight to a buffer or stream without building a string.
  */
 
- /* Visit root, g§etLeftChild(), getRightChild() */
+ /* Visit root, getLeftChild(), getRightChild() */
 string ExprTree::prefixOrder(const ExprTree & t)
 {
   string expression;
-  // Start from the root and convert toString()
-  expression += t.root->toString();
-
-  if(t.root->getLeftChild() != NULL)
-  {                                // Using ExprTree(TreeNode *n) instead of creating another function
-    expression += " " + prefixOrder(ExprTree(t.root->getLeftChild()));
-  }
-
-  if(t.root->getRightChild() != NULL)
-  {
-    expression += " " + prefixOrder(ExprTree(t.root->getRightChild()));
-  }
-
+  ExprWriter(expression).write(t.root, PrefixNotation);
   return expression;
 }
 
@@ -385,19 +397,7 @@ string ExprTree::prefixOrder(const ExprTree & t)
 string ExprTree::infixOrder(const ExprTree & t)
 {
   string expression;
-
-  if(t.root->getLeftChild() != NULL)
-  {
-    expression += infixOrder(ExprTree(t.root->getLeftChild())) + " ";
-  }
-
-  expression += t.root->toString();
-
-  if(t.root->getRightChild() != NULL)
-  {
-    expression += " " + infixOrder(ExprTree(t.root->getRightChild()));
-  }
-
+  ExprWriter(expression).write(t.root, InfixNotation);
   return expression;
 }
 
@@ -411,19 +411,7 @@ string ExprTree::infixOrder(const ExprTree & t)
 string ExprTree::postfixOrder(const ExprTree & t)
 {
   string expression;
-
-  if(t.root->getLeftChild() != NULL)
-  {
-    expression += postfixOrder(ExprTree(t.root->getLeftChild())) + " ";
-  }
-
-  if(t.root->getRightChild() != NULL)
-  {
-    expression += postfixOrder(ExprTree(t.root->getRightChild())) + " ";
-  }
-
-  expression += t.root->toString();
-
+  ExprWriter(expression).write(t.root, PostfixNotation);
   return expression;
 }
 
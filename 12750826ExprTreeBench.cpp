@@ -0,0 +1,231 @@
+/***********************
+ * ExprTree benchmark suite
+ * 1. Generates seeded random expressions of four shapes (random, balanced,
+ *    left-deep and right-deep) with 10, 100, ... up to max_nodes nodes
+ * 2. Times each phase separately: tokenise, buildTree, evaluateWholeTree
+ *    and the prefix, infix and postfix serializers, repeating small inputs
+ *    so each measurement covers at least a million nodes
+ * 3. Measures the node memory of the built tree (NodeArena bytes per node)
+ * 4. Prints the results as JSON on standard output, so each phase can be
+ *    tracked for regressions; progress goes to standard error
+ *
+ * Build: g++ -O2 -std=c++11 12750826ExprTreeBench.cpp 12750826ExprTree.cpp
+ *        12750826ExprLexer.cpp 12750826ExprParser.cpp 12750826ExprVariables.cpp
+ *        12750826ExprWriter.cpp 12750826ExprBytecode.cpp TreeNode.cpp -o exprbench
+ * Run:   ./exprbench [max_nodes] [seed]     (defaults: 10000000, 12750826)
+ * *********************
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include "ExprTree.h"
+#include "12750826ExprLexer.h"
+#include "12750826ExprParser.h"
+#include "12750826NodeArena.h"
+
+enum Shape { Random, Balanced, LeftDeep, RightDeep };
+
+std::string shapeName(Shape s)
+{
+  switch(s)
+  {
+    case Random    : return "random";
+    case Balanced  : return "balanced";
+    case LeftDeep  : return "left-deep";
+    case RightDeep : return "right-deep";
+  }
+  return "";
+}
+
+/*
+ * Only + and -, with single-digit operands, so no shape overflows or
+ * divides by zero.
+ */
+char randomOperator(std::mt19937 & rng) { return rng() % 2 ? '+' : '-'; }
+
+char randomDigit(std::mt19937 & rng) { return (char)('0' + rng() % 10); }
+
+/*
+ * Appends a subtree with "leaves" operands, split evenly (balanced) or at
+ * a uniformly random point (random).
+ */
+void splitExpression(std::string & out, int leaves, bool balanced, std::mt19937 & rng)
+{
+  int left;
+
+  if(leaves == 1)
+  {
+    out += randomDigit(rng);
+    return;
+  }
+  left = balanced ? leaves / 2 : 1 + rng() % (leaves - 1);
+  out += '(';
+  splitExpression(out, left, balanced, rng);
+  out += randomOperator(rng);
+  splitExpression(out, leaves - left, balanced, rng);
+  out += ')';
+}
+
+/*
+ * Returns the text of an expression of shape "shape" with "nodes" nodes
+ * (rounded up to odd, as every operator has two operands).
+ */
+std::string generate(Shape shape, int nodes, std::mt19937 & rng)
+{
+  int leaves = nodes / 2 + 1;
+  std::string out;
+  int i;
+
+  switch(shape)
+  {
+    case Random   : splitExpression(out, leaves, false, rng); break;
+    case Balanced : splitExpression(out, leaves, true, rng); break;
+
+    case LeftDeep : // Operators are left associative, so no parentheses.
+      out += randomDigit(rng);
+      for(i = 1; i < leaves; i++)
+      {
+        out += randomOperator(rng);
+        out += randomDigit(rng);
+      }
+      break;
+
+    case RightDeep :
+      for(i = 1; i < leaves; i++)
+      {
+        out += randomDigit(rng);
+        out += randomOperator(rng);
+        out += '(';
+      }
+      out += randomDigit(rng);
+      out.append(leaves - 1, ')');
+      break;
+  }
+  return out;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+/*
+ * How many times to repeat a phase on "nodes" nodes, so small inputs
+ * are not timed with a single clock reading.
+ */
+int repetitions(int nodes)
+{
+  long long reps = 1000000LL / nodes;
+  return reps < 1 ? 1 : (int)reps;
+}
+
+/*
+ * Prints "name": {"ns": per run, "ns_per_node": ...}.
+ */
+void printPhase(const char * name, double ns, int nodes, bool last)
+{
+  std::cout << "        \"" << name << "\": {\"ns\": " << ns << ", \"ns_per_node\": " << ns / nodes << "}"
+            << (last ? "" : ",") << "\n";
+}
+
+void benchmark(Shape shape, int nodes, unsigned int seed, bool last)
+{
+  std::mt19937 rng(seed);
+  std::string text = generate(shape, nodes, rng);
+  int reps = repetitions(nodes);
+  vector<string> tokens;
+  vector<ExprToken> lexed;
+  std::string printed;
+  long long check = 0;
+  int r;
+
+  // tokenise
+  Clock::time_point start = Clock::now();
+  for(r = 0; r < reps; r++) { tokens = ExprTree::tokenise(text); }
+  double tokeniseNs = elapsedNs(start) / reps;
+
+  // buildTree
+  double buildNs = 0;
+  for(r = 0; r < reps; r++)
+  {
+    start = Clock::now();
+    ExprTree tree = ExprTree::buildTree(tokens);
+    buildNs += elapsedNs(start);
+  }
+  buildNs /= reps; // (Freeing the previous tree is not counted.)
+
+  ExprTree tree = ExprTree::buildTree(tokens);
+  nodes = tree.size();
+
+  // evaluate
+  start = Clock::now();
+  for(r = 0; r < reps; r++) { check += tree.evaluateWholeTree(); }
+  double evaluateNs = elapsedNs(start) / reps;
+
+  // serializers
+  start = Clock::now();
+  for(r = 0; r < reps; r++) { printed = ExprTree::prefixOrder(tree); }
+  double prefixNs = elapsedNs(start) / reps;
+
+  start = Clock::now();
+  for(r = 0; r < reps; r++) { printed = ExprTree::infixOrder(tree); }
+  double infixNs = elapsedNs(start) / reps;
+
+  start = Clock::now();
+  for(r = 0; r < reps; r++) { printed = ExprTree::postfixOrder(tree); }
+  double postfixNs = elapsedNs(start) / reps;
+
+  // Node memory, from an arena built the same way buildTree builds one.
+  NodeArena arena;
+  lexExpression(text.data(), text.size(), lexed);
+  parseTokens(&lexed[0], &lexed[0] + lexed.size(), arena);
+
+  std::cout << "    {\n"
+            << "      \"shape\": \"" << shapeName(shape) << "\",\n"
+            << "      \"nodes\": " << nodes << ",\n"
+            << "      \"repetitions\": " << reps << ",\n"
+            << "      \"value\": " << tree.evaluateWholeTree() << ",\n"
+            << "      \"bytes_per_node\": " << (double)arena.bytes() / arena.size() << ",\n"
+            << "      \"phases\": {\n";
+  printPhase("tokenise", tokeniseNs, nodes, false);
+  printPhase("buildTree", buildNs, nodes, false);
+  printPhase("evaluate", evaluateNs, nodes, false);
+  printPhase("prefixOrder", prefixNs, nodes, false);
+  printPhase("infixOrder", infixNs, nodes, false);
+  printPhase("postfixOrder", postfixNs, nodes, true);
+  std::cout << "      }\n"
+            << "    }" << (last ? "" : ",") << "\n";
+
+  std::cerr << shapeName(shape) << " " << nodes << " nodes done (" << check << ")" << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+  int maxNodes = argc > 1 ? atoi(argv[1]) : 10000000;
+  unsigned int seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 12750826;
+  Shape shapes[] = { Random, Balanced, LeftDeep, RightDeep };
+  int s, nodes;
+
+  std::cout << "{\n"
+            << "  \"benchmark\": \"ExprTree\",\n"
+            << "  \"seed\": " << seed << ",\n"
+            << "  \"sizeof_TreeNode\": " << sizeof(TreeNode) << ",\n"
+            << "  \"results\": [\n";
+  for(s = 0; s < 4; s++)
+  {
+    for(nodes = 10; nodes <= maxNodes; nodes *= 10)
+    {
+      benchmark(shapes[s], nodes, seed, s == 3 && (long long)nodes * 10 > maxNodes);
+    }
+  }
+  std::cout << "  ]\n"
+            << "}" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include "12750826ExprVariables.h"
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+/*
+ * A name that is looked up in place, without copying it into a
+ * std::string first.
+ */
+struct NameKey {
+  const char * data;
+  std::size_t length;
+};
+
+struct NameHash {
+  std::size_t operator()(const NameKey & key) const
+  {
+    std::size_t hash = 2166136261u; // FNV-1a.
+    std::size_t i;
+
+    for(i = 0; i < key.length; i++) { hash = (hash ^ (unsigned char)key.data[i]) * 16777619u; }
+    return hash;
+  }
+};
+
+struct NameEqual {
+  bool operator()(const NameKey & a, const NameKey & b) const
+  {
+    return a.length == b.length && std::memcmp(a.data, b.data, a.length) == 0;
+  }
+};
+
+typedef std::unordered_map<NameKey, int, NameHash, NameEqual> NameMap;
+
+/*
+ * Names by id, and ids by name. The keys of "ids" (and of every thread's
+ * cache) point into "names", whose strings never move or change.
+ */
+struct VariableRegistry {
+  std::mutex lock;
+  std::deque<std::string> names;
+  NameMap ids;
+};
+
+static VariableRegistry & registry()
+{
+  static VariableRegistry instance;
+  return instance;
+}
+
+int variableId(const char * name, std::size_t length)
+{
+  static thread_local NameMap cache;
+  NameKey key = { name, length };
+  NameMap::iterator cached = cache.find(key);
+  int id;
+
+  if(cached != cache.end()) { return cached->second; }
+
+  {
+    VariableRegistry & r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    NameMap::iterator it = r.ids.find(key);
+
+    if(it != r.ids.end())
+    {
+      key = it->first;
+      id = it->second;
+    }
+    else
+    {
+      if((int)r.names.size() >= MaxVariables) { return -1; }
+      r.names.push_back(std::string(name, length));
+      key.data = r.names.back().data();
+      id = r.names.size() - 1;
+      r.ids[key] = id;
+    }
+  }
+  cache[key] = id;
+  return id;
+}
+
+int variableId(const std::string & name)
+{
+  return variableId(name.data(), name.size());
+}
+
+std::string variableName(int id)
+{
+  VariableRegistry & r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+
+  if(id < 0 || id >= (int)r.names.size()) { return ""; }
+  return r.names[id];
+}
+
+TreeNode * createVariableNode(int id, NodeArena & arena)
+{
+  return arena.create(Variable, id);
+}
+
+bool isVariable(TreeNode * node)
+{
+  return node != NULL && node->getOperator() == Variable;
+}
+
+int variableOf(TreeNode * node)
+{
+  return node->getValue();
+}
@@ -0,0 +1,54 @@
+#ifndef _EXPR_VARIABLES_H
+#define _EXPR_VARIABLES_H
+
+/*
+ * Named variables in ExprTree expressions ("price * qty + 5").
+ *
+ * Names are interned once into a process-wide registry and referred to by
+ * a small integer id from then on. In a tree a variable is a single
+ * Variable node (TreeNode.h) holding the id.
+ * ExprTree::evaluate treats a variable as 0; to give variables values,
+ * compile() the tree and use CompiledExpr (12750826ExprBytecode.h).
+ */
+#include <cstddef>
+#include <string>
+#include "TreeNode.h"
+#include "12750826NodeArena.h"
+
+/*
+ * Most names the registry will hold; names are never removed, so this
+ * bounds the memory untrusted input can make it use.
+ */
+const int MaxVariables = 1 << 20;
+
+/*
+ * @return The id for variable "name", registering it on first use, or -1
+ *         if it is new and the registry already holds MaxVariables names.
+ *         Safe to call from several threads at once. Each thread keeps
+ *         its own cache of the ids it has looked up, so after the first
+ *         time a thread sees a name this neither allocates nor locks.
+ */
+int variableId(const char * name, std::size_t length);
+int variableId(const std::string & name);
+
+/*
+ * @return The name registered for "id".
+ */
+std::string variableName(int id);
+
+/*
+ * @desc Creates the node for variable "id" in "arena".
+ */
+TreeNode * createVariableNode(int id, NodeArena & arena);
+
+/*
+ * @return True if "node" is a Variable node.
+ */
+bool isVariable(TreeNode * node);
+
+/*
+ * @return The id of variable node "node" (isVariable(node) must be true).
+ */
+int variableOf(TreeNode * node);
+
+#endif
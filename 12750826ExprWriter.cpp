@@ -0,0 +1,191 @@
+#include "12750826ExprWriter.h"
+#include "12750826ExprVariables.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+/*
+ * "00" to "99", so formatInt emits two digits per division.
+ */
+static const char digitPairs[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+std::size_t formatInt(int value, char * out)
+{
+  char digits[10];
+  char * p = digits + sizeof(digits);
+  unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+  std::size_t length = 0;
+
+  while(magnitude >= 100)
+  {
+    unsigned int pair = (magnitude % 100) * 2;
+    magnitude /= 100;
+    *--p = digitPairs[pair + 1];
+    *--p = digitPairs[pair];
+  }
+  if(magnitude >= 10)
+  {
+    *--p = digitPairs[magnitude * 2 + 1];
+    *--p = digitPairs[magnitude * 2];
+  }
+  else
+  {
+    *--p = (char)('0' + magnitude);
+  }
+
+  if(value < 0) { out[length++] = '-'; }
+  std::memcpy(out + length, p, digits + sizeof(digits) - p);
+  return length + (digits + sizeof(digits) - p);
+}
+
+ExprWriter::ExprWriter(char * b, std::size_t c)
+  : used(0), total(0), buffer(b), capacity(c), stream(0), text(0) {}
+
+ExprWriter::ExprWriter(std::ostream & out)
+  : used(0), total(0), buffer(0), capacity(0), stream(&out), text(0) {}
+
+ExprWriter::ExprWriter(std::string & out)
+  : used(0), total(0), buffer(0), capacity(0), stream(0), text(&out) {}
+
+void ExprWriter::flush()
+{
+  if(buffer != NULL && capacity > 0)
+  {
+    std::size_t room = total < capacity - 1 ? capacity - 1 - total : 0;
+    std::size_t copied = used < room ? used : room;
+
+    // Once the output is truncated, total is past the end of the buffer.
+    if(copied > 0) { std::memcpy(buffer + total, chunk, copied); }
+    buffer[std::min(total + copied, capacity - 1)] = '\0';
+  }
+  else if(stream != NULL)
+  {
+    stream->write(chunk, used);
+  }
+  else if(text != NULL)
+  {
+    text->append(chunk, used);
+  }
+  total += used;
+  used = 0;
+}
+
+void ExprWriter::put(const char * s, std::size_t length)
+{
+  if(length > ChunkSize)
+  {
+    flush();
+    if(stream != NULL) { stream->write(s, length); total += length; return; }
+    if(text != NULL) { text->append(s, length); total += length; return; }
+  }
+  while(length > 0)
+  {
+    std::size_t room = ChunkSize - used;
+    std::size_t n = length < room ? length : room;
+
+    std::memcpy(chunk + used, s, n);
+    used += n;
+    s += n;
+    length -= n;
+    if(used == ChunkSize) { flush(); }
+  }
+}
+
+const std::string & ExprWriter::nameOf(int id)
+{
+  if(id >= (int)names.size()) { names.resize(id + 1); }
+  if(names[id].empty()) { names[id] = variableName(id); }
+  return names[id];
+}
+
+/*
+ * Writes the token for "node" (TreeNode::toString, or a variable's
+ * name), with a space before every token but the first.
+ */
+void ExprWriter::putToken(TreeNode * node, bool & first)
+{
+  if(!first) { put(' '); }
+  first = false;
+
+  if(isVariable(node))
+  {
+    const std::string & name = nameOf(variableOf(node));
+    put(name.data(), name.size());
+    return;
+  }
+  if(!node->isOperator())
+  {
+    put(node->getValue());
+    return;
+  }
+  switch(node->getOperator())
+  {
+    case Plus   : put('+'); break;
+    case Minus  : put('-'); break;
+    case Times  : put('*'); break;
+    case Divide : put('/'); break;
+    default     : break; // NoOp prints as an empty token.
+  }
+}
+
+void ExprWriter::write(TreeNode * root, ExprNotation notation)
+{
+  std::vector<std::pair<TreeNode *, bool> > pending; // Node, and whether its children are done.
+  TreeNode * node = root;
+  bool first = true;
+
+  if(root == NULL) { return; }
+
+  switch(notation)
+  {
+    case PrefixNotation :
+      // Root first; the right child goes on the stack first so the left
+      // one comes off first.
+      pending.push_back(std::make_pair(root, false));
+      while(!pending.empty())
+      {
+        node = pending.back().first;
+        pending.pop_back();
+        putToken(node, first);
+        if(node->getRightChild() != NULL) { pending.push_back(std::make_pair(node->getRightChild(), false)); }
+        if(node->getLeftChild() != NULL) { pending.push_back(std::make_pair(node->getLeftChild(), false)); }
+      }
+      break;
+
+    case InfixNotation :
+      // The stack holds nodes whose left subtree is being printed.
+      while(node != NULL || !pending.empty())
+      {
+        while(node != NULL)
+        {
+          pending.push_back(std::make_pair(node, false));
+          node = node->getLeftChild();
+        }
+        node = pending.back().first;
+        pending.pop_back();
+        putToken(node, first);
+        node = node->getRightChild();
+      }
+      break;
+
+    case PostfixNotation :
+      pending.push_back(std::make_pair(root, false));
+      while(!pending.empty())
+      {
+        node = pending.back().first;
+        if(pending.back().second)
+        {
+          pending.pop_back();
+          putToken(node, first);
+          continue;
+        }
+        pending.back().second = true;
+        if(node->getRightChild() != NULL) { pending.push_back(std::make_pair(node->getRightChild(), false)); }
+        if(node->getLeftChild() != NULL) { pending.push_back(std::make_pair(node->getLeftChild(), false)); }
+      }
+      break;
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef _EXPR_WRITER_H
+#define _EXPR_WRITER_H
+
+/*
+ * Single-pass serialisers for expression trees.
+ *
+ * ExprWriter prints a tree in prefix, infix or postfix notation, one token
+ * per node separated by single spaces (the same text as
+ * ExprTree::prefixOrder/infixOrder/postfixOrder), straight into a
+ * caller-supplied char buffer, a std::ostream or a std::string:
+ *
+ *   ExprWriter out(std::cout);
+ *   out.write(tree.getRoot(), InfixNotation);
+ *   out.put('\n');
+ *
+ * Each node is visited once from an explicit stack, tokens are staged in
+ * a fixed 4 KiB chunk that is handed on when full, and integers are
+ * formatted two digits at a time without going through a stringstream,
+ * so printing is O(n) time and O(depth) memory.
+ */
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "TreeNode.h"
+
+enum ExprNotation { PrefixNotation, InfixNotation, PostfixNotation };
+
+/*
+ * Writes the decimal form of "value" to out, which must have room for
+ * 11 characters. Returns the number of characters written.
+ */
+std::size_t formatInt(int value, char * out);
+
+class ExprWriter {
+
+private:
+
+  static const std::size_t ChunkSize = 4096;
+
+  char chunk[ChunkSize];
+  std::size_t used;     // Bytes staged in chunk.
+  std::size_t total;    // Bytes produced so far, including any that did not fit.
+
+  char * buffer;        // Exactly one of these is the destination.
+  std::size_t capacity;
+  std::ostream * stream;
+  std::string * text;
+
+  std::vector<std::string> names; // Variable names by id, looked up once each.
+
+  void reserve(std::size_t bytes) { if(used + bytes > ChunkSize) { flush(); } }
+  void putToken(TreeNode * node, bool & first);
+  const std::string & nameOf(int id);
+
+public:
+
+  /*
+   * @desc  Writes into buffer[0, capacity). Output that does not fit is
+   *        counted by length() but dropped; the buffer is NUL terminated
+   *        (when capacity > 0) by flush().
+   */
+  ExprWriter(char * buffer, std::size_t capacity);
+
+  explicit ExprWriter(std::ostream & out);
+
+  /*
+   * @desc Appends to "out".
+   */
+  explicit ExprWriter(std::string & out);
+
+  ~ExprWriter() { flush(); }
+
+  ExprWriter(const ExprWriter &) = delete;
+  ExprWriter & operator=(const ExprWriter &) = delete;
+
+  /*
+   * @desc Writes the tree under "root" (nothing if it is NULL).
+   */
+  void write(TreeNode * root, ExprNotation notation);
+
+  void put(char c)
+  {
+    reserve(1);
+    chunk[used++] = c;
+  }
+
+  void put(const char * s, std::size_t length);
+
+  void put(int value)
+  {
+    reserve(11);
+    used += formatInt(value, chunk + used);
+  }
+
+  /*
+   * @desc Hands everything staged so far to the destination.
+   */
+  void flush();
+
+  /*
+   * @return Characters produced so far; for a buffer, more than its
+   *         capacity means the output was truncated.
+   */
+  std::size_t length() const { return total + used; }
+};
+
+#endif
@@ -0,0 +1,98 @@
+/***********************
+ * ExprWriter buffer-mode test
+ * 1. Writes far more than capacity + one chunk (4 KiB) into a small
+ *    caller buffer surrounded by guard bytes
+ * 2. Checks the buffer holds the first capacity - 1 characters and a
+ *    terminating NUL, that length() counts everything produced, and that
+ *    no guard byte was touched
+ * 3. Does the same with a tree written in each notation
+ *
+ * Build: g++ -O2 -std=c++11 12750826ExprWriterTest.cpp 12750826ExprWriter.cpp
+ *        12750826ExprTree.cpp 12750826ExprLexer.cpp 12750826ExprParser.cpp
+ *        12750826ExprVariables.cpp 12750826ExprBytecode.cpp TreeNode.cpp -o writertest
+ * Run:   ./writertest     (exit status 0 on success)
+ * *********************
+ */
+
+#include <iostream>
+#include <cstring>
+#include <string>
+#include "ExprTree.h"
+#include "12750826ExprWriter.h"
+
+static const std::size_t Guard = 64;
+static const char GuardByte = (char)0xA5;
+
+/*
+ * @return True if "area" (capacity bytes with Guard bytes either side)
+ *         holds the truncated "expected" and the guards are intact.
+ */
+bool checkBuffer(const char * area, std::size_t capacity, const std::string & expected, std::size_t length)
+{
+  const char * buffer = area + Guard;
+  std::size_t kept = capacity - 1 < expected.size() ? capacity - 1 : expected.size();
+  std::size_t i;
+
+  for(i = 0; i < Guard; i++)
+  {
+    if(area[i] != GuardByte || buffer[capacity + i] != GuardByte) { return false; }
+  }
+  return length == expected.size()
+      && std::memcmp(buffer, expected.data(), kept) == 0
+      && buffer[kept] == '\0';
+}
+
+int main()
+{
+  const std::size_t capacity = 10;
+  char area[Guard + capacity + Guard];
+  std::string expected;
+  int failures = 0;
+  int i;
+
+  // Raw output: 5 KiB and more, through put().
+  std::memset(area, GuardByte, sizeof(area));
+  {
+    ExprWriter out(area + Guard, capacity);
+    for(i = 0; i < 2000; i++)
+    {
+      out.put(i);
+      out.put(' ');
+      expected += std::to_string(i) + " ";
+    }
+    out.flush();
+    if(!checkBuffer(area, capacity, expected, out.length()))
+    {
+      std::cout << "FAIL: put() past the buffer" << std::endl;
+      failures++;
+    }
+  }
+
+  // A tree big enough to need several chunks, in each notation.
+  std::string text = "1";
+  for(i = 2; i < 3000; i++) { text += "+" + std::to_string(i); }
+  ExprTree tree = ExprTree::buildTree(ExprTree::tokenise(text));
+  ExprNotation notations[] = { PrefixNotation, InfixNotation, PostfixNotation };
+  std::string printed[] = { ExprTree::prefixOrder(tree), ExprTree::infixOrder(tree), ExprTree::postfixOrder(tree) };
+
+  for(i = 0; i < 3; i++)
+  {
+    std::size_t length;
+
+    std::memset(area, GuardByte, sizeof(area));
+    {
+      ExprWriter out(area + Guard, capacity);
+      out.write(tree.getRoot(), notations[i]);
+      out.flush();
+      length = out.length();
+    } // The destructor flushes again.
+    if(printed[i].size() <= capacity + 4096 || !checkBuffer(area, capacity, printed[i], length))
+    {
+      std::cout << "FAIL: write() past the buffer, notation " << i << std::endl;
+      failures++;
+    }
+  }
+
+  std::cout << (failures == 0 ? "PASS" : "FAILED") << std::endl;
+  return failures == 0 ? 0 : 1;
+}
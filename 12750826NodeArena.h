@@ -0,0 +1,125 @@
+#ifndef _NODE_ARENA_H
+#define _NODE_ARENA_H
+
+/*
+ * Bump allocator for TreeNodes.
+ *
+ * Nodes are carved out of large blocks in allocation order, so creating a
+ * node is a pointer increment, a tree's nodes sit next to each other in
+ * memory, and the whole tree is released at once when the arena goes
+ * away (TreeNode holds no resources, so no per-node destructor runs).
+ * An ExprTree owns the arena its nodes came from; moving the tree moves
+ * the arena's blocks without touching the nodes.
+ */
+#include <cstddef>
+#include <new>
+#include <vector>
+#include "TreeNode.h"
+
+class NodeArena {
+
+private:
+
+  std::vector<TreeNode *> blocks;
+  std::size_t used;     // Nodes handed out from the last block.
+  std::size_t capacity; // Nodes that fit in the last block.
+  std::size_t count;    // Nodes handed out in total.
+  std::size_t reserved; // Bytes held in blocks.
+
+  static const std::size_t FirstBlockNodes = 64;
+  static const std::size_t MaxBlockNodes = 64 * 1024;
+
+  /*
+   * @desc Returns raw storage for one more node, starting a new block
+   *       (twice the size of the previous one) when the last is full.
+   */
+  void * allocate()
+  {
+    if(used == capacity)
+    {
+      capacity = blocks.empty() ? FirstBlockNodes : capacity * 2;
+      if(capacity > MaxBlockNodes) { capacity = MaxBlockNodes; }
+      blocks.push_back(static_cast<TreeNode *>(::operator new(capacity * sizeof(TreeNode))));
+      reserved += capacity * sizeof(TreeNode);
+      used = 0;
+    }
+    count++;
+    return blocks.back() + used++;
+  }
+
+  void release()
+  {
+    std::size_t i;
+
+    for(i = 0; i < blocks.size(); i++) { ::operator delete(blocks[i]); }
+    blocks.clear();
+    reserved = 0;
+  }
+
+public:
+
+  NodeArena() : used(0), capacity(0), count(0), reserved(0) {}
+
+  ~NodeArena() { release(); }
+
+  NodeArena(NodeArena && other)
+    : blocks(), used(other.used), capacity(other.capacity), count(other.count), reserved(other.reserved)
+  {
+    blocks.swap(other.blocks);
+    other.used = other.capacity = other.count = other.reserved = 0;
+  }
+
+  NodeArena & operator=(NodeArena && other)
+  {
+    if(this != &other)
+    {
+      release();
+      blocks.swap(other.blocks);
+      used = other.used;
+      capacity = other.capacity;
+      count = other.count;
+      reserved = other.reserved;
+      other.used = other.capacity = other.count = other.reserved = 0;
+    }
+    return *this;
+  }
+
+  NodeArena(const NodeArena &) = delete;
+  NodeArena & operator=(const NodeArena &) = delete;
+
+  /* Creates a value node. */
+  TreeNode * create(int value) { return new (allocate()) TreeNode(value); }
+
+  /* Creates an operator node. */
+  TreeNode * create(Operator op) { return new (allocate()) TreeNode(op); }
+
+  /* Creates a childless node of kind "op" holding "value" (a Variable). */
+  TreeNode * create(Operator op, int value) { return new (allocate()) TreeNode(op, value); }
+
+  /*
+   * @desc Frees every node at once. Keeps the last (largest) block for
+   *       reuse, so an arena recycled per expression stops allocating.
+   */
+  void clear()
+  {
+    TreeNode * keep = blocks.empty() ? 0 : blocks.back();
+
+    if(keep) { blocks.pop_back(); }
+    release();
+    if(keep)
+    {
+      blocks.push_back(keep);
+      reserved = capacity * sizeof(TreeNode);
+    }
+    used = 0;
+    count = 0;
+  }
+
+  /* Number of nodes created since the arena was made or cleared. */
+  std::size_t size() const { return count; }
+
+  /* Bytes of block storage currently held. */
+  std::size_t bytes() const { return reserved; }
+};
+
+#endif
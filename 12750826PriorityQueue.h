@@ -10,6 +10,95 @@
 #include <list>
 #include <utility>
 #include <iostream>
+#include <cstddef>
+#include <unordered_map>
+
+/*
+ * The sift functions and layouts below are constexpr from C++20 on, so
+ * fixed-capacity queues (12750826StaticPriorityQueue.h) can be used in
+ * constant expressions. Older standards get plain inline functions.
+ */
+#if __cplusplus >= 202002L
+#define PQ_CONSTEXPR constexpr
+#else
+#define PQ_CONSTEXPR
+#endif
+
+/*
+ * The default memory layout for PriorityQueue: the classic implicit binary
+ * heap where the children of index i sit at 2i + 1 and 2i + 2.
+ * A layout only decides where a node's parent and children live in the
+ * 'nodes' vector (and which vector type holds them); the sift logic in
+ * PriorityQueue is the same for every layout. See 12750826BHeapPriorityQueue.h
+ * for a page-aware alternative.
+ */
+struct BinaryHeapLayout {
+
+  template <typename Node>
+  struct storage { typedef std::vector<Node> type; };
+
+  static PQ_CONSTEXPR std::size_t parent(std::size_t index) { return (index - 1) / 2; }
+
+  /* @param k 0 for the left child, 1 for the right child. */
+  static PQ_CONSTEXPR std::size_t child(std::size_t index, int k) { return 2 * index + 1 + k; }
+};
+
+/*
+ * @desc  Sifts nodes[index] up towards the root until its parent has a lower
+ *        or equal priority. Works on any indexable storage of std::pair<int,E>
+ *        (a vector, a plain array, ...) laid out by Layout.
+ * @param Index is the node to sift, normally the node just appended.
+ */
+template <typename Layout, typename Nodes>
+PQ_CONSTEXPR void heapSiftUp(Nodes & nodes, std::size_t index)
+{
+  std::size_t parent = 0;
+
+  while(index > 0)
+  {
+    parent = Layout::parent(index); // (Index - 1) / 2 for the binary layout.
+
+    // If the parent has a higher priority value, swap it with the current node and
+    // carry on from where the parent was. Stop once index reaches 0 (the root).
+    if(nodes[parent].first > nodes[index].first)
+    {
+      std::swap(nodes[index], nodes[parent]);
+      index = parent;
+    }
+    else { break; }
+  }
+}
+
+/*
+ * Disclaimer: http://www.geeksforgeeks.org/binary-heap/ guide used to help build this function.
+ * @desc  Rearranges the tree below nodes[index] to rectify violated properties. It is recursed
+ *        to ensure all the right and left subtrees are ordered.
+ * @param Size is the number of nodes in use, index is the node to sift.
+ */
+template <typename Layout, typename Nodes>
+PQ_CONSTEXPR void heapSiftDown(Nodes & nodes, std::size_t size, std::size_t index)
+{
+  std::size_t right = Layout::child(index, 1); // To find right child's position [2n + 2].
+  std::size_t left = Layout::child(index, 0); // To find left child's position is [2n + 1].
+  std::size_t lowestPriority = index;
+
+  // NOTE: The first condition ensures that it's not reaching a leaf node.
+  //       The second condition checks if the child's priority is less than the lowest so far.
+  if(left < size && nodes[left].first < nodes[lowestPriority].first)
+  {
+    lowestPriority = left;
+  }
+  if(right < size && nodes[right].first < nodes[lowestPriority].first)
+  {
+    lowestPriority = right;
+  }
+  if(lowestPriority != index) // lowestPriority has changed to either left and/or right.
+  {
+    // Swap index with the new lowestPriority and recurse throughout the left and right subtrees.
+    std::swap(nodes[index], nodes[lowestPriority]);
+    heapSiftDown<Layout>(nodes, size, lowestPriority);
+  }
+}
 
 /*
  * This class implements a priority queue ADT
@@ -17,96 +106,182 @@
  * Lower priority values precede higher values in
  * the ordering.
  * The template type E is the element type.
+ * The template type Layout decides how the heap is placed in memory
+ * (see BinaryHeapLayout above).
  * See the tests for examples.
  */
-template <typename E>
+template <typename E, typename Layout = BinaryHeapLayout>
 class PriorityQueue {
 
 private:
 
+  typedef typename Layout::template storage<std::pair<int,E> >::type Storage;
+
   /*
    * @desc nodes of paired vector to store priority and elements.
    *       'nodes' because its represented into a tree structure.
    */
-   std::vector<std::pair<int,E> > nodes;
+   Storage nodes;
 
-public:
+  /*
+   * @desc  With buffered inserts on, only nodes[0, heapEnd) are in heap order;
+   *        the nodes after it were appended by insert and are merged in by
+   *        flush() before anything needs the order.
+   */
+  bool buffered;
+  std::size_t heapEnd;
 
-  /* Used for debugging purposes */
-  void toString()
+  /*
+   * @desc  Swaps two nodes and keeps track of where the nodes with a pending
+   *        edit (ids >= 0) went; used by update_batch.
+   */
+  void swapTracked(std::size_t a, std::size_t b, std::vector<int> & ids, std::vector<std::size_t> & where)
   {
-    typename std::vector<std::pair<int,E> >::iterator it;
+    std::swap(nodes[a], nodes[b]);
+    std::swap(ids[a], ids[b]);
+    if(ids[a] >= 0) { where[ids[a]] = a; }
+    if(ids[b] >= 0) { where[ids[b]] = b; }
+  }
 
-    std::cout << "START" << std::endl;
+  /*
+   * @desc  heapSiftUp followed by heapSiftDown for one node, via swapTracked.
+   */
+  void fixTracked(std::size_t index, std::vector<int> & ids, std::vector<std::size_t> & where)
+  {
+    std::size_t parent, left, right, lowestPriority;
 
-    for(it = nodes.begin(); it != nodes.end(); it++)
+    while(index > 0 && nodes[parent = Layout::parent(index)].first > nodes[index].first)
     {
-      std::cout << "Priority: " << it->first << "E: " << it->second << std::endl;
+      swapTracked(index, parent, ids, where);
+      index = parent;
+    }
+    for(;;)
+    {
+      left = Layout::child(index, 0);
+      right = Layout::child(index, 1);
+      lowestPriority = index;
+      if(left < nodes.size() && nodes[left].first < nodes[lowestPriority].first) { lowestPriority = left; }
+      if(right < nodes.size() && nodes[right].first < nodes[lowestPriority].first) { lowestPriority = right; }
+      if(lowestPriority == index) { break; }
+      swapTracked(index, lowestPriority, ids, where);
+      index = lowestPriority;
     }
-
-    std::cout << "END" << std::endl;
   }
 
   /*
-   * @desc  Similar to heapifyDown -- where the function starts at index 0 and compares its subtrees.
-   *        heapifyUp compares the currentNode to its parentNode and stops until condition is 0 (reaching the root).
-   * @param Int will be used to specify last node in the vector; refer to line #128.
+   * @desc  Gives node changed[i] the priority newPriorities[i] and repairs
+   *        the heap, either by sifting each changed node (k log n) or, once
+   *        that would cost more, by one O(n) rebuild.
    */
-  void heapifyUp(int index)
+  void applyEdits(std::vector<std::size_t> & changed, const std::vector<int> & newPriorities)
   {
-    std::pair<int,E> parentNode, currentNode;
+    std::size_t i, depth = 1;
+
+    if(changed.empty()) { return; }
+
+    for(i = nodes.size(); i > 1; i /= 2) { depth++; }
 
-    while(index > 0)
+    // Large batch, or buffered inserts still out of heap order: apply
+    // everything and heapify once.
+    if(changed.size() * depth * 2 >= nodes.size() || heapEnd < nodes.size())
     {
-      parentNode = nodes[(index - 1) / 2]; // (Index - 1) / 2 is the formula to find parent.
-      currentNode = nodes[index]; // Index is being specified as the last node.
+      for(i = 0; i < changed.size(); i++) { nodes[changed[i]].first = newPriorities[i]; }
+      rebuild();
+      return;
+    }
 
-      // If this condition runs, currentNode will swap with the parentNode, then index
-      // will be set to where the parentNode was. Keep doing this until index reaches 0.
-      // Once index is 0, break out of the loop.
-      if(parentNode.first > currentNode.first)
-      {
-        // NOTE: swap doesn't understand parentNode or currentNode. We have to refer directly to vector 'nodes'.
-        std::swap(nodes[index], nodes[(index - 1) / 2]);
-        index = (index - 1) / 2;
-      }
-      else { break; }
+    // Small batch: apply edits one at a time so the heap is valid before each
+    // sift, tracking the nodes still waiting for their edit as they move.
+    std::vector<int> ids(nodes.size(), -1);
+    for(i = 0; i < changed.size(); i++) { ids[changed[i]] = i; }
+    for(i = 0; i < changed.size(); i++)
+    {
+      std::size_t index = changed[i]; // Kept up to date by swapTracked.
+      ids[index] = -1;
+      nodes[index].first = newPriorities[i];
+      fixTracked(index, ids, changed);
     }
   }
 
   /*
-   * Disclaimer: http://www.geeksforgeeks.org/binary-heap/ guide used to help build this function.
-   * @desc  This function rearranges the tree to rectify violated properties. heapifyDown is recursed
-   *        to ensure all the right and left subtrees are ordered.
-   * @param Index is then used to compare whether the left or right children are less than index.
+   * @desc  Restores the heap over all nodes in O(n) (Floyd's heapify): every
+   *        node is sifted down after its subtrees, which always sit at higher indices.
    */
-  void heapifyDown(int index)
+  void rebuild()
   {
-    int rightPriority = nodes[2 * index + 2].first; // To find right child's position [2n + 2].
-    int leftPriority = nodes[2 * index + 1].first; // To find left child's position is [2n + 1].
-    int lowestPriority = index;
+    std::size_t i;
 
-    // NOTE: The first condition ensures that it's not reaching a leaf node.
-    //       The second condition checks if the left node is less than index argument.
-    if(leftPriority < nodes.size() && leftPriority < index)
-    {
-      lowestPriority = leftPriority;
-    }
-    if(rightPriority < nodes.size() && rightPriority < index)
+    for(i = nodes.size(); i > 0; i--) { heapifyDown(i - 1); }
+    heapEnd = nodes.size();
+  }
+
+  /*
+   * @desc  Merges buffered inserts into the heap: a few are sifted up one by
+   *        one, but once that would cost more than O(n) the whole vector is
+   *        re-heapified instead.
+   */
+  void flush()
+  {
+    std::size_t pending = nodes.size() - heapEnd;
+    std::size_t depth = 1, i;
+
+    if(pending == 0) { return; }
+
+    for(i = nodes.size(); i > 1; i /= 2) { depth++; }
+    if(pending * depth >= nodes.size())
     {
-      lowestPriority = rightPriority;
+      rebuild();
+      return;
     }
-    if(lowestPriority != index) // lowestPriority has changed to either leftPriority and/or rightPriority.
+    for(; heapEnd < nodes.size(); heapEnd++) { heapifyUp(heapEnd); }
+  }
+
+public:
+
+  /* Used for debugging purposes */
+  void toString()
+  {
+    typename Storage::iterator it;
+
+    std::cout << "START" << std::endl;
+
+    for(it = nodes.begin(); it != nodes.end(); it++)
     {
-      // Swap index with the new lowestPriority and recurse throughout the left and right subtrees.
-      std::swap(nodes[index], nodes[lowestPriority]);
-      heapifyDown(lowestPriority);
+      std::cout << "Priority: " << it->first << "E: " << it->second << std::endl;
     }
+
+    std::cout << "END" << std::endl;
   }
+
+  /*
+   * @desc  Similar to heapifyDown -- where the function starts at index 0 and compares its subtrees.
+   *        heapifyUp compares the currentNode to its parentNode and stops until condition is 0 (reaching the root).
+   * @param Int will be used to specify last node in the vector; see insert().
+   */
+  void heapifyUp(int index) { heapSiftUp<Layout>(nodes, index); }
+
+  /*
+   * @desc  This function rearranges the tree to rectify violated properties, see heapSiftDown().
+   * @param Index is the node whose subtrees are compared.
+   */
+  void heapifyDown(int index) { heapSiftDown<Layout>(nodes, nodes.size(), index); }
+
   /*
    * A constructor, if you need it.
    */
-  PriorityQueue(){};
+  PriorityQueue() : buffered(false), heapEnd(0) {};
+
+  /*
+   * @desc  Turns buffered inserts on or off. When on, insert only appends to
+   *        the vector (amortised O(1)) and the heap is repaired in one go the
+   *        next time peek, remove_front, ordered_view or a priority change
+   *        needs it. Suits bursts of inserts with only occasional removals.
+   */
+  void set_buffered_inserts(bool on)
+  {
+    if(!on) { flush(); }
+    buffered = on;
+  }
 
   /*
    * @desc This function adds a new element "element" to the queue
@@ -114,7 +289,7 @@ public:
    */
   void insert(int priority, E element)
   {
-    //typename std::vector<std::pair<int,E> >::iterator it;
+    //typename Storage::iterator it;
     std::pair<int,E> parentNode, currentNode;
     std::pair<int, E> newPair(priority, element); // Create new pair of nodes.
     int index;
@@ -124,12 +299,14 @@ public:
     {
       // Otherwise append new node into the back of the vector.
       nodes.push_back(newPair);
+      if(buffered) { return; } // Left for flush() to sift into place.
       // Index is set to the last node in the vector because we are inserting
       // new nodes in the last available left of the subtree.
       index = nodes.size() - 1;
       // Call heapifyUp to fix min-heap property by swapping. Keep traversing up
       // and swapping until index hits 0 (reaching the root).
       heapifyUp(index);
+      heapEnd = nodes.size();
     }
   }
 
@@ -157,18 +334,23 @@ public:
   {
     E rootElement;
 
+    flush();
     if(nodes.size() == 1) // If size of node is 1 -- means it's the root
     {
       rootElement = nodes[0].second;
       nodes.pop_back(); // NOTE: Calling rootElement doesn't work as it specifies an index.
+      heapEnd = 0;
       return rootElement;
     }
     else if(nodes.size() > 1) // Remove_front for several elements -- we need to heapifyDown
     {
       rootElement = nodes[0].second;
-      nodes.erase(nodes.begin());
+      // Move the last node into the root and sift it down. Erasing the front
+      // would shift every node and break the heap (and any layout other than
+      // a plain array).
       nodes[0] = nodes[nodes.size() - 1];
-      // nodes.pop_back();
+      nodes.pop_back();
+      heapEnd = nodes.size();
       heapifyDown(0);
       return rootElement;
     }
@@ -182,6 +364,7 @@ public:
    */
   E peek()
   {
+    flush();
     // For peek at the 0 index
     if(nodes.size() == 1)
     {
@@ -201,7 +384,7 @@ public:
   std::vector<E> get_all_elements()
   {
     std::vector<E> elements;
-    typename std::vector<std::pair<int, E> >::iterator it;
+    typename Storage::iterator it;
 
     for(it = nodes.begin(); it != nodes.end(); it++)
         {
@@ -217,7 +400,7 @@ public:
    */
   bool contains(E element)
   {
-    typename std::vector<std::pair<int,E> >::iterator it;
+    typename Storage::iterator it;
 
     for(it = nodes.begin(); it != nodes.end(); it++)
     {
@@ -236,7 +419,7 @@ public:
    */
   int get_priority(E element)
   {
-    typename std::vector<std::pair<int,E> >::iterator it;
+    typename Storage::iterator it;
 
     for(it = nodes.begin(); it != nodes.end(); it++)
     {
@@ -256,7 +439,7 @@ public:
   std::vector<int> get_all_priorities()
   {
     std::vector<int> priorities;
-    typename std::vector<std::pair<int,E> >::iterator it;
+    typename Storage::iterator it;
 
     for(it = nodes.begin(); it != nodes.end(); it++)
     {
@@ -267,22 +450,140 @@ public:
   }
 
   /*
-   * @desc  Finds the first element that matches
-   *        "element", and changes its priority to "new_priority".
+   * @desc  Finds the elements that match
+   *        "element", changes their priority to "new_priority" and moves them
+   *        back into place. See update_batch() for many edits at once.
    * @param Element is used to reference a current element in the vector and changes its
-   *        priority to new_priority.
+   *        priority to new_priority. Only needs operator== on E.
    */
   void change_priority(E element, int new_priority)
   {
-    typename std::vector<std::pair<int,E> >::iterator it;
+    std::vector<std::size_t> changed;
+    std::size_t i;
 
-    for(it = nodes.begin(); it != nodes.end(); it++)
+    for(i = 0; i < nodes.size(); i++)
     {
-      if(element == it->second) // When element matches in nodes,
+      if(element == nodes[i].second && nodes[i].first != new_priority) { changed.push_back(i); }
+    }
+    applyEdits(changed, std::vector<int>(changed.size(), new_priority));
+  }
+
+  /*
+   * @desc  Applies many change_priority edits with one pass over the queue.
+   *        Matching nodes are found through a hash map of the edits, then the
+   *        heap is repaired either by sifting each changed node (k log n) or,
+   *        once that would cost more, by one O(n) rebuild.
+   *        Requires std::hash<E>. If an element appears twice in the batch,
+   *        the last edit wins.
+   * @param First, last is a range of (element, new_priority) pairs.
+   */
+  template <typename Iterator>
+  void update_batch(Iterator first, Iterator last)
+  {
+    std::unordered_map<E,int> edits;
+    typename std::unordered_map<E,int>::iterator edit;
+    std::vector<std::size_t> changed;
+    std::vector<int> newPriorities;
+    std::size_t i;
+
+    for(; first != last; ++first) { edits[first->first] = first->second; }
+    if(edits.empty()) { return; }
+
+    for(i = 0; i < nodes.size(); i++)
+    {
+      edit = edits.find(nodes[i].second);
+      if(edit != edits.end() && edit->second != nodes[i].first)
       {
-        it->first = new_priority; // call int, in E to change new_priority.
+        changed.push_back(i);
+        newPriorities.push_back(edit->second);
       }
     }
+    applyEdits(changed, newPriorities);
+  }
+
+  /*
+   * @desc  Iterates the queue in priority order without removing anything.
+   *        The heap is walked with a small frontier heap of the nodes whose
+   *        parents have already been visited, so the first k elements cost
+   *        O(k log k) no matter how large the queue is. Any insert or removal
+   *        on the queue invalidates the view.
+   */
+  class OrderedView {
+
+  public:
+
+    class iterator {
+
+    private:
+
+      const Storage * nodes;
+      // (priority, index into nodes) pairs, kept as a binary heap.
+      std::vector<std::pair<int,std::size_t> > frontier;
+
+      void visit(std::size_t index)
+      {
+        frontier.push_back(std::pair<int,std::size_t>((*nodes)[index].first, index));
+        heapSiftUp<BinaryHeapLayout>(frontier, frontier.size() - 1);
+      }
+
+    public:
+
+      iterator() : nodes(0) {}
+
+      explicit iterator(const Storage * n) : nodes(n)
+      {
+        if(!nodes->empty()) { visit(0); }
+      }
+
+      const std::pair<int,E> & operator*() const { return (*nodes)[frontier[0].second]; }
+      const std::pair<int,E> * operator->() const { return &(*nodes)[frontier[0].second]; }
+
+      /* Replaces the node just visited by its children in the frontier. */
+      iterator & operator++()
+      {
+        std::size_t index = frontier[0].second;
+        std::size_t left = Layout::child(index, 0);
+        std::size_t right = Layout::child(index, 1);
+
+        frontier[0] = frontier[frontier.size() - 1];
+        frontier.pop_back();
+        heapSiftDown<BinaryHeapLayout>(frontier, frontier.size(), 0);
+
+        if(left < nodes->size()) { visit(left); }
+        if(right < nodes->size()) { visit(right); }
+        return *this;
+      }
+
+      bool operator==(const iterator & other) const
+      {
+        if(frontier.empty() || other.frontier.empty()) { return frontier.empty() == other.frontier.empty(); }
+        return frontier[0].second == other.frontier[0].second;
+      }
+
+      bool operator!=(const iterator & other) const { return !(*this == other); }
+    };
+
+    explicit OrderedView(const Storage & n) : nodes(&n) {}
+
+    iterator begin() const { return iterator(nodes); }
+    iterator end() const { return iterator(); }
+
+  private:
+
+    const Storage * nodes;
+  };
+
+  /*
+   * @desc   Returns a view of the (priority, element) pairs in priority order,
+   *         e.g. to show the next 100 jobs without copying the queue:
+   *           PriorityQueue<Job>::OrderedView view = q.ordered_view();
+   *           for(it = view.begin(); n < 100 && it != view.end(); ++it, n++)
+   * @return OrderedView - a lazy, read-only range over this queue.
+   */
+  OrderedView ordered_view()
+  {
+    flush();
+    return OrderedView(nodes);
   }
 
   /*
@@ -0,0 +1,163 @@
+/***********************
+ * PriorityQueue layout benchmark
+ * 1. Fills a queue with N random priorities
+ * 2. Runs a hold workload (remove_front, then insert a new random priority)
+ * 3. Reports time, dTLB misses and page faults per operation for the binary
+ *    layout and the B-heap layout over 4 KiB and 2 MiB pages
+ * 4. Reports how many pages a leaf-to-root path crosses in each layout,
+ *    which is the number of page misses a cold sift pays
+ *
+ * Build: g++ -O2 -std=c++11 12750826PriorityQueueBench.cpp -o pqbench
+ * Run:   ./pqbench [N ...]        (default: 1000000 10000000 100000000)
+ *
+ * dTLB misses come from perf_event_open and show as "n/a" when the kernel
+ * does not allow it (see /proc/sys/kernel/perf_event_paranoid).
+ * *********************
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "12750826BHeapPriorityQueue.h"
+
+/*
+ * Opens a counter for data TLB read misses of this process.
+ * Returns -1 if counters are not available.
+ */
+int openTlbCounter()
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB
+              | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+              | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+long pageFaults()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt + usage.ru_majflt;
+}
+
+/*
+ * Average number of distinct pages on the path from a random leaf to the
+ * root, i.e. the pages heapifyUp/heapifyDown walk through.
+ */
+template <typename Layout>
+double pagesPerPath(long n, std::size_t nodeBytes, std::size_t pageBytes)
+{
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<long> leaf(n / 2, n - 1);
+  long total = 0;
+  int samples = 1000;
+  int i;
+
+  for(i = 0; i < samples; i++)
+  {
+    std::size_t index = leaf(rng);
+    std::size_t page = index * nodeBytes / pageBytes;
+    total++;
+    while(index > 0)
+    {
+      index = Layout::parent(index);
+      if(index * nodeBytes / pageBytes != page)
+      {
+        page = index * nodeBytes / pageBytes;
+        total++;
+      }
+    }
+  }
+
+  return (double)total / samples;
+}
+
+template <typename Queue, typename Layout>
+void run(const std::string & name, long n, long ops, std::size_t pageBytes)
+{
+  Queue q;
+  std::mt19937 rng(12750826);
+  std::uniform_int_distribution<int> priority(0, 1 << 30);
+  long long tlbMisses = 0;
+  long faults;
+  long i;
+  int counter = openTlbCounter();
+
+  for(i = 0; i < n; i++) { q.insert(priority(rng), (int)i); }
+
+  faults = pageFaults();
+  if(counter >= 0)
+  {
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for(i = 0; i < ops; i++)
+  {
+    q.remove_front();
+    q.insert(priority(rng), (int)i);
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  if(counter >= 0)
+  {
+    ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+    if(read(counter, &tlbMisses, sizeof(tlbMisses)) != sizeof(tlbMisses)) { tlbMisses = -1; }
+    close(counter);
+  }
+  faults = pageFaults() - faults;
+
+  std::cout << name << "\tN=" << n
+            << "\tns/op=" << std::chrono::duration<double, std::nano>(end - start).count() / ops
+            << "\tdTLB-misses/op=";
+  if(counter >= 0 && tlbMisses >= 0) { std::cout << (double)tlbMisses / ops; }
+  else { std::cout << "n/a"; }
+  std::cout << "\tfaults/op=" << (double)faults / ops
+            << "\tpages/path=" << pagesPerPath<Layout>(n, sizeof(std::pair<int,int>), pageBytes) << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+  std::vector<long> sizes;
+  int i;
+
+  for(i = 1; i < argc; i++) { sizes.push_back(atol(argv[i])); }
+  if(sizes.empty())
+  {
+    sizes.push_back(1000000);
+    sizes.push_back(10000000);
+    sizes.push_back(100000000);
+  }
+
+  const std::size_t small = 4096, huge = 2 * 1024 * 1024;
+  typedef BHeapLayout<bheapNodesPerPage(small, sizeof(std::pair<int,int>)), small> SmallLayout;
+  typedef BHeapLayout<bheapNodesPerPage(huge, sizeof(std::pair<int,int>)), huge> HugeLayout;
+
+  for(i = 0; i < (int)sizes.size(); i++)
+  {
+    long ops = 1000000;
+    run<PriorityQueue<int>, BinaryHeapLayout>("binary", sizes[i], ops, small);
+    run<PriorityQueue<int, SmallLayout>, SmallLayout>("bheap-4k", sizes[i], ops, small);
+    run<PriorityQueue<int, HugeLayout>, HugeLayout>("bheap-2m", sizes[i], ops, huge);
+  }
+
+  return 0;
+}
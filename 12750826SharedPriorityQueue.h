@@ -0,0 +1,430 @@
+#ifndef _SHARED_PR_QUEUE_H
+#define _SHARED_PR_QUEUE_H
+
+/*
+ * A PriorityQueue that lives in a POSIX shared memory segment, so producer
+ * and consumer processes on one host can share it directly:
+ *
+ *   SharedPriorityQueue<Job> q("/jobs", 100000); // Creates or attaches.
+ *   q.insert(3, job);                            // In one process...
+ *   Job next;
+ *   q.wait_remove_front(next);                   // ...and in another.
+ *
+ * The segment holds a header followed by a fixed-capacity binary heap of
+ * (priority, element) nodes. Nothing in it is a pointer: nodes are found by
+ * index from wherever each process mapped the segment, so E must be
+ * trivially copyable (no std::string, no pointers into private memory).
+ *
+ * Access is serialised by a process-shared robust mutex. If a process dies
+ * while holding it, the next one to lock it repairs the heap: every change
+ * first writes the node being moved, the hole it will end up in and the new
+ * size to a journal in the header, and the heap is only ever one journal
+ * replay plus a rebuild away from consistent. An element that was being
+ * removed by the dead process is lost with it (at-most-once delivery).
+ *
+ * Link with -pthread (and -lrt on older glibc). Requires C++11.
+ */
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <atomic>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+template <typename E>
+class SharedPriorityQueue {
+
+  static_assert(std::is_trivially_copyable<E>::value,
+                "SharedPriorityQueue elements are copied between processes byte for byte");
+
+private:
+
+  struct Node {
+    int priority;
+    E element;
+  };
+
+  /*
+   * @desc Start of the shared segment. The nodes follow at nodesOffset().
+   */
+  struct Header {
+    std::atomic<unsigned long> ready; // Set to Magic once initialised.
+    std::size_t capacity;
+    std::size_t size;
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+
+    // Crash journal, valid while inFlight is set.
+    int inFlight;
+    std::size_t hole;        // Slot that 'journal' belongs in if we die now.
+    std::size_t journalSize; // Size of the heap once the change completes.
+    Node journal;
+  };
+
+  static const unsigned long Magic = 0x12750826UL;
+  static const int AttachTimeoutMs = 5000;
+
+  int fd;
+  std::size_t bytes;
+  Header * header;
+  Node * nodes;
+
+  static std::size_t nodesOffset()
+  {
+    return (sizeof(Header) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+  }
+
+  /* Stops the compiler from reordering the journal writes around heap writes. */
+  static void barrier() { std::atomic_signal_fence(std::memory_order_seq_cst); }
+
+  static void check(int rc, const char * what)
+  {
+    if(rc != 0) { throw std::runtime_error(std::string(what) + ": " + strerror(rc)); }
+  }
+
+  /*
+   * @desc Unmaps the segment and closes it, as far as they were set up.
+   */
+  void detach()
+  {
+    if(header) { munmap(header, bytes); }
+    if(fd >= 0) { close(fd); }
+    header = 0;
+    fd = -1;
+  }
+
+  /*
+   * @desc Like check(), for failures while attaching: releases what the
+   *       constructor has set up so far (the destructor will not run).
+   */
+  void abandon(int rc, const char * what)
+  {
+    detach();
+    check(rc, what);
+  }
+
+  /*
+   * @desc  Yields while another process finishes creating the segment, and
+   *        gives up once it has taken AttachTimeoutMs (the creator most
+   *        likely died half way).
+   */
+  void waitForCreator(std::chrono::steady_clock::time_point start, const std::string & name)
+  {
+    if(std::chrono::steady_clock::now() - start > std::chrono::milliseconds(AttachTimeoutMs))
+    {
+      detach();
+      throw std::runtime_error("SharedPriorityQueue: timed out waiting for " + name + " to be initialised");
+    }
+    sched_yield();
+  }
+
+  void initialise(std::size_t capacity)
+  {
+    pthread_mutexattr_t mutexAttr;
+    pthread_condattr_t condAttr;
+
+    header->capacity = capacity;
+    header->size = 0;
+    header->inFlight = 0;
+
+    check(pthread_mutexattr_init(&mutexAttr), "pthread_mutexattr_init");
+    check(pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED), "pthread_mutexattr_setpshared");
+    check(pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST), "pthread_mutexattr_setrobust");
+    check(pthread_mutex_init(&header->mutex, &mutexAttr), "pthread_mutex_init");
+    pthread_mutexattr_destroy(&mutexAttr);
+
+    check(pthread_condattr_init(&condAttr), "pthread_condattr_init");
+    check(pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED), "pthread_condattr_setpshared");
+    check(pthread_cond_init(&header->notEmpty, &condAttr), "pthread_cond_init");
+    pthread_condattr_destroy(&condAttr);
+
+    header->ready.store(Magic);
+  }
+
+  /*
+   * @desc  Makes the heap consistent after its previous owner died: puts the
+   *        journalled node back, restores the size and re-heapifies.
+   */
+  void recover()
+  {
+    std::size_t i;
+
+    if(header->inFlight)
+    {
+      nodes[header->hole] = header->journal;
+      header->size = header->journalSize;
+      barrier();
+      header->inFlight = 0;
+    }
+    for(i = header->size; i > 0; i--)
+    {
+      std::size_t index = i - 1;
+      header->hole = index;
+      header->journal = nodes[index];
+      header->journalSize = header->size;
+      barrier();
+      header->inFlight = 1;
+      barrier();
+      siftDown(index);
+    }
+    pthread_mutex_consistent(&header->mutex);
+  }
+
+  void handleLockResult(int rc)
+  {
+    if(rc == EOWNERDEAD) { recover(); }
+    else { check(rc, "pthread_mutex_lock"); }
+  }
+
+  void lock() { handleLockResult(pthread_mutex_lock(&header->mutex)); }
+
+  void unlock() { pthread_mutex_unlock(&header->mutex); }
+
+  /*
+   * @desc  Moves the journalled node up from header->hole. Every step copies
+   *        the parent into the hole before moving the hole, so a crash at any
+   *        point leaves one stale slot that recover() overwrites.
+   */
+  void siftUp()
+  {
+    std::size_t index = header->hole;
+    std::size_t parent;
+
+    while(index > 0 && nodes[parent = (index - 1) / 2].priority > header->journal.priority)
+    {
+      nodes[index] = nodes[parent];
+      barrier();
+      header->hole = index = parent;
+      barrier();
+    }
+    nodes[index] = header->journal;
+    barrier();
+    header->inFlight = 0;
+  }
+
+  /*
+   * @desc  Moves the journalled node down from header->hole (index), see siftUp().
+   */
+  void siftDown(std::size_t index)
+  {
+    std::size_t child;
+
+    for(;;)
+    {
+      child = 2 * index + 1;
+      if(child >= header->size) { break; }
+      if(child + 1 < header->size && nodes[child + 1].priority < nodes[child].priority) { child++; }
+      if(nodes[child].priority >= header->journal.priority) { break; }
+
+      nodes[index] = nodes[child];
+      barrier();
+      header->hole = index = child;
+      barrier();
+    }
+    nodes[index] = header->journal;
+    barrier();
+    header->inFlight = 0;
+  }
+
+  /*
+   * @desc Removes the root; the mutex must be held and the heap non-empty.
+   */
+  E takeFront()
+  {
+    E rootElement = nodes[0].element;
+
+    if(header->size == 1)
+    {
+      header->size = 0;
+      return rootElement;
+    }
+
+    header->journal = nodes[header->size - 1];
+    header->hole = 0;
+    header->journalSize = header->size - 1;
+    barrier();
+    header->inFlight = 1;
+    barrier();
+    header->size = header->journalSize;
+    siftDown(0);
+    return rootElement;
+  }
+
+public:
+
+  /*
+   * @desc  Attaches to the shared queue called "name" (e.g. "/jobs"), creating
+   *        it with room for "capacity" elements if it does not exist yet.
+   *        Throws std::runtime_error if the segment cannot be set up, or
+   *        if its creator has not finished setting it up within
+   *        AttachTimeoutMs.
+   */
+  SharedPriorityQueue(const std::string & name, std::size_t capacity) : fd(-1), bytes(0), header(0), nodes(0)
+  {
+    bool created = true;
+    struct stat info;
+    void * base;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd < 0 && errno == EEXIST)
+    {
+      created = false;
+      fd = shm_open(name.c_str(), O_RDWR, 0600);
+    }
+    if(fd < 0) { check(errno, "shm_open"); }
+
+    if(created)
+    {
+      bytes = nodesOffset() + capacity * sizeof(Node);
+      if(ftruncate(fd, bytes) != 0) { abandon(errno, "ftruncate"); }
+    }
+    else
+    {
+      // The creator may still be sizing the segment.
+      for(;;)
+      {
+        if(fstat(fd, &info) != 0) { abandon(errno, "fstat"); }
+        if((std::size_t)info.st_size >= sizeof(Header)) { break; }
+        waitForCreator(start, name);
+      }
+      bytes = info.st_size;
+    }
+
+    base = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(base == MAP_FAILED) { abandon(errno, "mmap"); }
+    header = static_cast<Header *>(base);
+    nodes = reinterpret_cast<Node *>(static_cast<char *>(base) + nodesOffset());
+
+    if(created) { initialise(capacity); }
+    else
+    {
+      while(header->ready.load() != Magic) { waitForCreator(start, name); }
+    }
+  }
+
+  ~SharedPriorityQueue() { detach(); }
+
+  SharedPriorityQueue(const SharedPriorityQueue &) = delete;
+  SharedPriorityQueue & operator=(const SharedPriorityQueue &) = delete;
+
+  /*
+   * @desc Removes the segment name; processes already attached keep working.
+   */
+  static void unlink(const std::string & name) { shm_unlink(name.c_str()); }
+
+  /*
+   * @desc   This function adds a new element "element" to the queue
+   *         with priority "priority".
+   * @return False if the priority is negative or the queue is full.
+   */
+  bool insert(int priority, E element)
+  {
+    if(priority < 0) { return false; }
+
+    lock();
+    if(header->size == header->capacity)
+    {
+      unlock();
+      return false;
+    }
+
+    header->journal.priority = priority;
+    header->journal.element = element;
+    header->hole = header->size;
+    header->journalSize = header->size + 1;
+    barrier();
+    header->inFlight = 1;
+    barrier();
+    header->size = header->journalSize;
+    siftUp();
+
+    pthread_cond_signal(&header->notEmpty);
+    unlock();
+    return true;
+  }
+
+  /*
+   * @desc Takes the lowest priority value element off the queue, and returns it.
+   *       Returns E() if the queue is empty.
+   */
+  E remove_front()
+  {
+    E element = E();
+
+    try_remove_front(element);
+    return element;
+  }
+
+  /*
+   * @desc   Like remove_front, but tells an empty queue apart from E().
+   * @return False if the queue was empty.
+   */
+  bool try_remove_front(E & element)
+  {
+    lock();
+    if(header->size == 0)
+    {
+      unlock();
+      return false;
+    }
+    element = takeFront();
+    unlock();
+    return true;
+  }
+
+  /*
+   * @desc Blocks until an element is available, then removes and returns it.
+   */
+  void wait_remove_front(E & element)
+  {
+    lock();
+    while(header->size == 0) { handleLockResult(pthread_cond_wait(&header->notEmpty, &header->mutex)); }
+    element = takeFront();
+    unlock();
+  }
+
+  /*
+   * @desc Returns the lowest priority value element in the queue, but leaves
+   *       it in the queue. Returns E() if the queue is empty.
+   */
+  E peek()
+  {
+    E element = E();
+
+    lock();
+    if(header->size > 0) { element = nodes[0].element; }
+    unlock();
+    return element;
+  }
+
+  /*
+   * @desc Return the size of elements in queue.
+   */
+  int size()
+  {
+    std::size_t n;
+
+    lock();
+    n = header->size;
+    unlock();
+    return n;
+  }
+
+  /*
+   * @desc Returns true if the queue has no elements, false otherwise.
+   */
+  bool empty() { return size() == 0; }
+
+  int capacity() const { return header->capacity; }
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef _STATIC_PR_QUEUE_H
+#define _STATIC_PR_QUEUE_H
+
+/*
+ * A fixed-capacity PriorityQueue that keeps its nodes inline: no heap
+ * allocation ever happens, so it can live on the stack of a latency
+ * critical path. It uses the same heapSiftUp/heapSiftDown as PriorityQueue.
+ *
+ * Every member is constexpr, so in C++20 a queue can be filled and drained
+ * at compile time, e.g.
+ *
+ *   constexpr int first() {
+ *     StaticPriorityQueue<int, 8> q;
+ *     q.insert(3, 30); q.insert(1, 10);
+ *     return q.remove_front(); // 10
+ *   }
+ *   static_assert(first() == 10);
+ *
+ * Requires C++20 (C++11 and later compile it without constexpr).
+ */
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "12750826PriorityQueue.h"
+
+template <typename E, std::size_t N>
+class StaticPriorityQueue {
+
+private:
+
+  /*
+   * @desc Inline storage of priority and element pairs; only the first
+   *       'count' are in use and they form a binary heap.
+   */
+  std::pair<int,E> nodes[N];
+  std::size_t count;
+
+public:
+
+  PQ_CONSTEXPR StaticPriorityQueue() : nodes(), count(0) {}
+
+  /*
+   * @desc This function adds a new element "element" to the queue
+   *       with priority "priority". Like negative priorities, inserts into
+   *       a full queue are ignored; check full() first if that matters.
+   */
+  PQ_CONSTEXPR void insert(int priority, E element)
+  {
+    if(priority < 0 || count == N) { return; }
+
+    nodes[count] = std::pair<int,E>(priority, element);
+    heapSiftUp<BinaryHeapLayout>(nodes, count);
+    count++;
+  }
+
+  /*
+   * @desc Similar to insert, but takes a whole vector of new things to add.
+   */
+  PQ_CONSTEXPR void insert_all(const std::vector<std::pair<int,E> > & new_elements)
+  {
+    for(std::size_t i = 0; i < new_elements.size(); i++)
+    {
+      insert(new_elements[i].first, new_elements[i].second);
+    }
+  }
+
+  /*
+   * @desc Takes the lowest priority value element off the queue, and returns it.
+   *       Returns E() if the queue is empty.
+   */
+  PQ_CONSTEXPR E remove_front()
+  {
+    if(count == 0) { return E(); }
+
+    E rootElement = nodes[0].second;
+    count--;
+    nodes[0] = nodes[count];
+    heapSiftDown<BinaryHeapLayout>(nodes, count, 0);
+    return rootElement;
+  }
+
+  /*
+   * @desc Returns the lowest priority value element in the queue, but leaves
+   *       it in the queue. Returns E() if the queue is empty.
+   */
+  PQ_CONSTEXPR E peek() const
+  {
+    if(count == 0) { return E(); }
+    return nodes[0].second;
+  }
+
+  /*
+   * @return Elements - containing all the elements in the queue (heap order).
+   */
+  PQ_CONSTEXPR std::vector<E> get_all_elements() const
+  {
+    std::vector<E> elements;
+
+    for(std::size_t i = 0; i < count; i++) { elements.push_back(nodes[i].second); }
+    return elements;
+  }
+
+  /*
+   * @desc Returns true if the queue contains element "element", false otherwise.
+   */
+  PQ_CONSTEXPR bool contains(const E & element) const
+  {
+    for(std::size_t i = 0; i < count; i++)
+    {
+      if(element == nodes[i].second) { return true; }
+    }
+    return false;
+  }
+
+  /*
+   * @desc Returns the priority of the first element that matches "element",
+   *       or -1 if there is none.
+   */
+  PQ_CONSTEXPR int get_priority(const E & element) const
+  {
+    for(std::size_t i = 0; i < count; i++)
+    {
+      if(element == nodes[i].second) { return nodes[i].first; }
+    }
+    return -1;
+  }
+
+  /*
+   * @return Priorities - containing all the priorities (heap order).
+   */
+  PQ_CONSTEXPR std::vector<int> get_all_priorities() const
+  {
+    std::vector<int> priorities;
+
+    for(std::size_t i = 0; i < count; i++) { priorities.push_back(nodes[i].first); }
+    return priorities;
+  }
+
+  /*
+   * @desc  Finds the first element that matches "element", changes its
+   *        priority to "new_priority" and sifts it back into place.
+   */
+  PQ_CONSTEXPR void change_priority(const E & element, int new_priority)
+  {
+    for(std::size_t i = 0; i < count; i++)
+    {
+      if(element == nodes[i].second)
+      {
+        nodes[i].first = new_priority;
+        heapSiftUp<BinaryHeapLayout>(nodes, i);
+        heapSiftDown<BinaryHeapLayout>(nodes, count, i);
+        return;
+      }
+    }
+  }
+
+  /*
+   * @desc Return the size of elements in queue.
+   */
+  PQ_CONSTEXPR int size() const { return count; }
+
+  /*
+   * @desc Returns the number of elements the queue can hold.
+   */
+  PQ_CONSTEXPR int capacity() const { return N; }
+
+  /*
+   * @desc Returns true if the queue has no elements, false otherwise.
+   */
+  PQ_CONSTEXPR bool empty() const { return count == 0; }
+
+  /*
+   * @desc Returns true if another insert would be ignored, false otherwise.
+   */
+  PQ_CONSTEXPR bool full() const { return count == N; }
+};
+
+#endif
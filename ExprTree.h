@@ -0,0 +1,54 @@
+#ifndef _EXPR_TREE_H
+#define _EXPR_TREE_H
+
+/*
+ * An arithmetic expression ("3 * (4 + 5)") held as a binary tree of
+ * TreeNodes: operators at the inner nodes, integers at the leaves.
+ */
+#include <string>
+#include <vector>
+#include <stack>
+#include <utility>
+#include <cstdlib>
+#include "TreeNode.h"
+#include "12750826NodeArena.h"
+#include "12750826ExprBytecode.h"
+
+using namespace std;
+
+class ExprTree {
+
+private:
+
+  TreeNode * root;
+  int _size;
+  NodeArena arena; // Owns the nodes of trees made by buildTree.
+
+public:
+
+  ExprTree();
+  ExprTree(TreeNode * r);
+  ExprTree(TreeNode * r, NodeArena && nodes);
+  ExprTree(ExprTree && other);
+  ExprTree & operator=(ExprTree && other);
+  ExprTree(const ExprTree &) = delete;
+  ExprTree & operator=(const ExprTree &) = delete;
+  ~ExprTree();
+
+  static vector<string> tokenise(string expression);
+  static ExprTree buildTree(vector<string> tokens, bool shareSubtrees = false);
+  static int evaluate(TreeNode * n);
+  static bool evaluate(TreeNode * n, int & value);
+  int evaluateWholeTree();
+  CompiledExpr compile();
+
+  static string prefixOrder(const ExprTree & t);
+  static string infixOrder(const ExprTree & t);
+  static string postfixOrder(const ExprTree & t);
+
+  int size();
+  bool isEmpty();
+  TreeNode * getRoot();
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "TreeNode.h"
+#include <sstream>
+
+TreeNode::TreeNode(int v) : op(Value), value(v), parent(0), leftChild(0), rightChild(0) {}
+
+TreeNode::TreeNode(Operator o) : op(o), value(0), parent(0), leftChild(0), rightChild(0) {}
+
+TreeNode::TreeNode(Operator o, int v) : op(o), value(v), parent(0), leftChild(0), rightChild(0) {}
+
+bool TreeNode::isOperator() { return op != Value; }
+
+bool TreeNode::isValue() { return op == Value; }
+
+Operator TreeNode::getOperator() { return op; }
+
+int TreeNode::getValue() { return value; }
+
+void TreeNode::setParent(TreeNode * node) { parent = node; }
+
+void TreeNode::setLeftChild(TreeNode * node) { leftChild = node; }
+
+void TreeNode::setRightChild(TreeNode * node) { rightChild = node; }
+
+TreeNode * TreeNode::getParent() { return parent; }
+
+TreeNode * TreeNode::getLeftChild() { return leftChild; }
+
+TreeNode * TreeNode::getRightChild() { return rightChild; }
+
+std::string TreeNode::toString()
+{
+  std::stringstream stream;
+
+  switch(op)
+  {
+    case Plus   : return "+";
+    case Minus  : return "-";
+    case Times  : return "*";
+    case Divide : return "/";
+    case NoOp   : return "";
+    case Variable : stream << '#'; break;
+    default     : break;
+  }
+  stream << value;
+  return stream.str();
+}
@@ -0,0 +1,70 @@
+#ifndef _TREE_NODE_H
+#define _TREE_NODE_H
+
+/*
+ * A node of an ExprTree: a Value node holding an integer, a Variable node
+ * holding a variable's id (12750826ExprVariables.h), or an operator node
+ * whose operands are its left and right children.
+ */
+#include <string>
+
+enum Operator {Value, Plus, Minus, Times, Divide, NoOp, Variable};
+
+class TreeNode {
+
+private:
+
+  Operator op;
+  int value;
+  TreeNode * parent;
+  TreeNode * leftChild;
+  TreeNode * rightChild;
+
+public:
+
+  /*
+   * @desc Creates a Value node holding "value".
+   */
+  TreeNode(int value);
+
+  /*
+   * @desc Creates an operator node with no children.
+   */
+  TreeNode(Operator op);
+
+  /*
+   * @desc Creates a node of kind "op" with no children that holds "value";
+   *       for a Variable node that is the variable's id.
+   */
+  TreeNode(Operator op, int value);
+
+  /*
+   * @desc Returns false for a Value and true for anything else, including
+   *       NoOp and Variable nodes, which have no children.
+   */
+  bool isOperator();
+
+  /*
+   * @desc Returns true if this node holds a value.
+   */
+  bool isValue();
+
+  Operator getOperator();
+  int getValue();
+
+  void setParent(TreeNode * node);
+  void setLeftChild(TreeNode * node);
+  void setRightChild(TreeNode * node);
+
+  TreeNode * getParent();
+  TreeNode * getLeftChild();
+  TreeNode * getRightChild();
+
+  /*
+   * @desc Returns "+", "-", "*" or "/" for an operator, "" for NoOp, the
+   *       number for a Value node and "#" and the id for a Variable.
+   */
+  std::string toString();
+};
+
+#endif